@@ -0,0 +1,72 @@
+#pragma once
+#include <SDL.h>
+#include <atomic>
+#include <blip/app/scheduler.hpp>
+#include <blip/buffer/buffer.hpp>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace app {
+enum class Workload { SCROLL, EDIT, REPLAY };
+
+// Scripted input for BlipBench. Feeds the event loop one step at a time and times each step from
+// the moment its input is queued until a frame that shows it has been presented. Steps start after
+// the first frame, so font loading and the initial layout are not counted.
+class Bench {
+  public:
+    static constexpr const size_t DEFAULT_STEPS = 1000;
+
+    // Counted by BlipBench's replacement operator new, on every thread.
+    static std::atomic<uint64_t> allocations;
+
+    Bench(Workload workload, size_t steps);
+    // Replays a recorded trace, one event per step.
+    explicit Bench(std::vector<SDL_Event> trace);
+
+    // Reads the command line:
+    //   scroll|edit <file size> [steps]
+    //   replay <trace> <file or file size>
+    // Sizes take a K, M or G suffix. Sets file to the file to open.
+    static std::optional<Bench> fromArgs(int argc, char *argv[], std::string &file);
+    // Writes a file of about the given size of code-like lines, reusing one from an earlier run.
+    static std::string generateFile(size_t bytes);
+
+    // Called at the top of every pass of the event loop. Starts the next step once the last one
+    // has finished; after the last step it queues SDL_QUIT.
+    void next(buffer::EditorBuffer &buffer, FrameScheduler &scheduler);
+    // A layout job with this sequence number was submitted during the pass.
+    void submitted(uint64_t sequence);
+    // A frame laid out by job sequence, or a later one, was presented.
+    void presented(uint64_t sequence);
+    // The pass is over; a step whose input damaged nothing is finished without a frame.
+    void endPass();
+    // Step times, total time, allocations, texture uploads and peak memory.
+    void report(std::ostream &out) const;
+
+  private:
+    enum class Phase { WARMUP, IDLE, QUEUED, DRAWING, DONE };
+
+    Workload workload;
+    size_t steps;
+    std::vector<SDL_Event> trace;
+    size_t step = 0;
+    Phase phase = Phase::WARMUP;
+    uint64_t target = 0;
+    Uint64 began = 0, ended = 0;
+    Uint64 started = 0;
+    uint64_t started_allocations = 0;
+    uint64_t started_uploads = 0;
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+
+    std::vector<double> frame_ms;
+    uint64_t total_allocations = 0;
+    uint64_t total_uploads = 0;
+    size_t frames = 0;
+
+    void finish(bool drawn);
+    uint64_t random();
+};
+}
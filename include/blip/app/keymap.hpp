@@ -0,0 +1,64 @@
+#pragma once
+#include <SDL.h>
+#include <blip/config/editor.hpp>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace app {
+enum class InputMode : Uint8 { NORMAL, INSERT, VISUAL, REPLACE, EDIT, COUNT };
+
+enum class Action : Uint8 {
+    NONE,
+    PENDING,
+    SAVE,
+    NEXT_BUFFER,
+    PREVIOUS_BUFFER,
+    UNDO,
+    REDO,
+    MOVE_LEFT,
+    MOVE_RIGHT,
+    MOVE_UP,
+    MOVE_DOWN,
+    GOTO_FIRST_LINE,
+    GOTO_LAST_LINE,
+    ENTER_NORMAL,
+    COMMIT,
+    NEWLINE,
+    DELETE_BACKWARD,
+};
+
+class Keymap;
+
+// Progress through a multi-key binding; reset whenever the keymap it points into is replaced.
+typedef struct {
+    const Keymap *keymap = nullptr;
+    InputMode mode = InputMode::COUNT;
+    uint32_t node = 0;
+} KeySequence;
+
+// Bindings compiled into a trie whose edges live in one hash table keyed by (node, modifiers, key),
+// so each key press is a single lookup no matter how many bindings exist.
+class Keymap {
+  public:
+    static std::shared_ptr<const Keymap> compile(const config::EditorConfig &state);
+
+    Action dispatch(KeySequence &sequence, InputMode mode, Uint16 modifiers, SDL_Keycode key) const;
+
+  private:
+    Keymap();
+    void bind(InputMode mode, std::initializer_list<config::Shortcut> keys, Action action);
+    void bindAll(std::initializer_list<config::Shortcut> keys, Action action);
+    static uint64_t edgeKey(uint32_t node, Uint16 modifiers, SDL_Keycode key);
+    static Uint16 normalize(Uint16 modifiers);
+
+    typedef struct {
+        Action action;
+        bool has_children;
+    } Node;
+
+    std::vector<Node> nodes;
+    std::unordered_map<uint64_t, uint32_t> edges;
+};
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <SDL.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace app {
+using LatencyClock = std::chrono::steady_clock;
+
+// Durations in fixed memory: eight buckets per power of two microseconds, so a percentile is off
+// by at most an eighth.
+class LatencyHistogram {
+  public:
+    void add(LatencyClock::duration duration);
+    uint64_t getCount() const;
+    // In milliseconds.
+    double percentile(double p) const;
+    double getMax() const;
+
+  private:
+    std::array<uint64_t, 64 * 8> buckets{};
+    uint64_t count = 0;
+    uint64_t max = 0;
+};
+
+enum class InputKind { KEY, TEXT, WHEEL, CLICK, COUNT };
+// delivered -> applied -> submitted -> laid out -> drawn -> presented
+enum class LatencyStage { INPUT, PREPARE, LAYOUT, DRAW, PRESENT, TOTAL, COUNT };
+
+// Follows each input event from the moment SDL queued it to the SDL_RenderPresent of the first frame
+// that shows it: applying it to the buffer, preparing the layout job, laying the frame out on the
+// worker, drawing it and presenting it. Events that damaged nothing are not counted.
+class LatencyTracker {
+  public:
+    static std::optional<InputKind> kindOf(const SDL_Event &event);
+
+    // Called as each event is polled; events that are not input are ignored.
+    void delivered(const SDL_Event &event);
+    // The events polled so far have been applied to the buffer and viewport.
+    void applied();
+    void submitted(uint64_t sequence);
+    // Drops events of this pass that were never submitted.
+    void endPass();
+    // A frame laid out from job sequence was drawn and has just been presented.
+    void presented(uint64_t sequence, LatencyClock::time_point laid_out, LatencyClock::time_point drawn);
+
+    // One line per input kind: total percentiles and the p95 of each stage, for the overlay.
+    std::vector<std::string> summarize() const;
+    // Logs every stage of every input kind at debug level.
+    void dump() const;
+
+  private:
+    typedef struct Input {
+        InputKind kind;
+        LatencyClock::time_point delivered, applied, submitted;
+        uint64_t sequence;
+    } Input;
+
+    std::vector<Input> pass;
+    std::vector<Input> in_flight;
+    std::array<std::array<LatencyHistogram, (size_t)LatencyStage::COUNT>, (size_t)InputKind::COUNT> histograms;
+};
+}
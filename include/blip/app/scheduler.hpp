@@ -0,0 +1,33 @@
+#pragma once
+#include <SDL.h>
+#include <atomic>
+#include <cstdint>
+
+namespace app {
+
+// Puts the main loop to sleep until there is something to do: input, a wake-up posted from
+// another thread, or a frame deadline. Nothing is rendered while asleep, so an idle editor uses
+// no CPU; with a vsynced renderer every burst of events woken into is drawn as one frame.
+class FrameScheduler {
+  public:
+    // Registers the SDL event used for wake-ups. Call after SDL_Init.
+    bool init();
+    Uint32 getWakeEvent() const;
+
+    // Safe to call from any thread. Wake-ups are coalesced until the main loop drains the event.
+    void wake();
+    // Called by the main loop when it receives the wake event.
+    void onWake();
+
+    // Asks for a frame no later than the given SDL_GetTicks64 time.
+    void requestFrameAt(Uint64 ticks);
+    // Blocks until an event is queued or the earliest requested deadline passes, without
+    // removing the event. Returns true if a deadline was reached.
+    bool wait();
+
+  private:
+    Uint32 wake_event = (Uint32)-1;
+    std::atomic<bool> wake_pending{false};
+    Uint64 deadline = UINT64_MAX;
+};
+}
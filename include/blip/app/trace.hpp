@@ -0,0 +1,29 @@
+#pragma once
+#include <SDL.h>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace app {
+// Key and text input in the compact form macros and traces share: 'T', a length byte and the text,
+// or 'K', the keycode and the modifiers. Other events are not encoded.
+void encodeEvent(std::string &out, const SDL_Event &event);
+// Decodes the event at offset, which must be one encodeEvent wrote. Returns the offset after it.
+size_t decodeEvent(const std::string &data, size_t offset, SDL_Event &event);
+
+// Appends the key and text events of a live session to a trace file, for BlipBench to replay.
+class TraceRecorder {
+  public:
+    bool open(const std::string &path);
+    bool isOpen() const;
+    void record(const SDL_Event &event);
+
+  private:
+    std::ofstream out;
+    std::string encoded;
+};
+
+// Every event of a trace file, or nothing if the file is missing, not a trace or truncated.
+std::optional<std::vector<SDL_Event>> loadTrace(const std::string &path);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <array>
+#include <blip/buffer/table.hpp>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace buffer {
+
+inline constexpr const size_t BRACKET_CHUNK_SIZE = 4096;
+
+// Bracket balance summaries for fixed-size chunks of the document, kept in a segment tree so
+// the chunk holding a match is found in O(log n) and only that chunk is scanned. Edits rescan
+// just the chunks they touch. The index is built lazily on the first query, so buffers that
+// never ask for a match pay nothing. Brackets inside strings and comments are not skipped.
+class BracketIndex {
+  public:
+    static bool isBracket(char c);
+
+    void onReplace(const PieceTable &table, size_t index, size_t erased, size_t inserted);
+
+    std::optional<size_t> findMatch(const PieceTable &table, size_t index);
+    std::optional<size_t> findEnclosingOpen(const PieceTable &table, size_t index);
+
+  private:
+    static constexpr const int KINDS = 3;
+
+    typedef struct {
+        int64_t net;
+        int64_t min_prefix;
+    } Balance;
+
+    typedef struct {
+        size_t length;
+        std::array<Balance, KINDS> balance;
+    } Block;
+
+    bool valid = false;
+    std::vector<Block> chunks;
+    std::vector<Block> tree;
+    size_t leaf_count = 0;
+
+    void rebuild(const PieceTable &table);
+    void rebuildTree();
+    void combine(size_t node);
+    void updateLeaf(size_t chunk);
+    void rescan(const PieceTable &table, size_t chunk, size_t start);
+    std::pair<size_t, size_t> locate(size_t index) const;
+    size_t chunkStart(size_t chunk) const;
+    size_t searchForward(size_t node, size_t lo, size_t hi, size_t from, int kind, int64_t &depth) const;
+    size_t searchBackward(size_t node, size_t lo, size_t hi, size_t before, int kind, int64_t &depth) const;
+    std::optional<size_t> matchForward(const PieceTable &table, size_t from, int kind, int64_t depth) const;
+    std::optional<size_t> matchBackward(const PieceTable &table, size_t before, int kind, int64_t depth) const;
+};
+}
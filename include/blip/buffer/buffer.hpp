@@ -1,16 +1,28 @@
 #pragma once
 #include <SDL_stdinc.h>
+#include <blip/buffer/brackets.hpp>
+#include <blip/buffer/indent.hpp>
+#include <blip/buffer/snapshot.hpp>
 #include <blip/buffer/table.hpp>
+#include <blip/buffer/wrap.hpp>
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
 namespace buffer {
 
+// A state to return to. The text before changed_from and the last unchanged_tail bytes are the
+// same in this state and the one next to it, so restoring it only touches the range in between;
+// both are SIZE_MAX while nothing differs.
 typedef struct {
     PieceTable::State table_state;
     size_t cursor_position;
-    std::vector<size_t> line_starts;
+    std::shared_ptr<const std::vector<size_t>> line_starts;
+    size_t changed_from = SIZE_MAX;
+    size_t unchanged_tail = SIZE_MAX;
 } EditRecord;
 
 class EditorBuffer {
@@ -19,31 +31,98 @@ class EditorBuffer {
 
     void insertText(const std::string &text);
     void backspace(size_t amount = 1);
+    void eraseRange(size_t start, size_t end);
+    void replace(size_t offset, size_t length, const std::string &text);
+    void overwrite(const std::string &text);
 
+    // Edits between begin and end share one undo record; commits in between are ignored.
+    void beginTransaction();
+    void endTransaction();
     void commit();
     void undo();
     void redo();
 
     std::string getText() const;
+    Snapshot snapshot() const;
+    uint64_t getVersion() const;
+    // Rows [first, last) changed since the last call; last is SIZE_MAX when the rows below shifted.
+    std::optional<std::pair<size_t, size_t>> takeDamagedRows();
+    bool isModified() const;
+    // The current text is what the file holds.
+    void markSaved();
+    // Whether anything was edited, undone or redone since the buffer was loaded, so that dropping
+    // it would lose history even once it is saved.
+    bool hasEdits() const;
+    size_t getMemoryUsage() const;
     size_t getCursor() const;
     size_t getTotalLength() const;
+    size_t getLineCount() const;
+    size_t getLineStart(size_t row) const;
+    size_t getLineFromIndex(size_t index) const;
+    TextIterator iteratorAt(size_t index) const;
+    void setTabWidth(size_t width);
+    std::optional<size_t> getIndentWidth(size_t row);
+    // The width of the nearest line above row with content, which blank lines below it carry.
+    size_t getCarriedIndent(size_t row);
+    // Soft wrap at a width in columns, 0 for none. Visual rows are the rows on screen; without
+    // wrapping they are the lines.
+    void setWrapWidth(size_t columns);
+    size_t getVisualRowCount() const;
+    size_t getVisualRow(size_t row) const;
+    size_t getVisualRowOf(size_t index) const;
+    // The line holding a visual row, and which of its rows it is.
+    std::pair<size_t, size_t> locateVisualRow(size_t visual_row) const;
+    // Measures the lines above row until they cover rows_before visual rows, and row and the lines
+    // below it until they cover rows_after. Rows below a line whose count changed are damaged.
+    void measureWrap(size_t row, size_t rows_before, size_t rows_after);
+    // Measures lines off screen, up to about budget bytes. Returns true while any are left.
+    bool refineWrap(size_t budget);
     void setCursor(Sint64 new_pos);
-    void moveLeft();
-    void moveRight();
-    void moveUp();
-    void moveDown();
+    void moveLeft(size_t count = 1);
+    void moveRight(size_t count = 1);
+    void moveUp(size_t count = 1);
+    void moveDown(size_t count = 1);
+    void gotoLine(size_t row);
+    void deleteLines(size_t count = 1);
+    void deleteChars(size_t count = 1);
     std::pair<size_t, size_t> getCursorPosition2D() const;
     size_t getCursorPositionFrom2D(size_t row, size_t col) const;
     void setCursorToBeginningColumn();
     void setCursorToEndingColumn();
+    void moveWordForward(size_t count = 1, bool big_word = false);
+    void moveWordBackward(size_t count = 1, bool big_word = false);
+    void moveWordEnd(size_t count = 1, bool big_word = false);
+    std::pair<size_t, size_t> getWordObject(bool around, bool big_word = false) const;
+    std::pair<size_t, size_t> getParagraphObject() const;
+    std::optional<size_t> findMatchingBracket(size_t index);
+    std::optional<std::pair<size_t, size_t>> findEnclosingScope(size_t index);
+    bool jumpToMatchingBracket();
 
   private:
     PieceTable table;
+    BracketIndex brackets;
+    IndentCache indents;
+    WrapIndex wraps;
     size_t cursor_pos;
-    std::vector<size_t> line_starts;
+    std::shared_ptr<const std::vector<size_t>> line_starts;
     size_t desired_col = 0;
-    void recomputeAllLines();
-    void updateLineStarts(const std::string &text);
+    uint64_t version = 0;
+    uint64_t saved_version = 0;
+    size_t transaction_depth = 0;
+    size_t pending_row = SIZE_MAX;
+    size_t pending_delta = 0;
+    size_t damage_first = SIZE_MAX;
+    size_t damage_last = 0;
+    std::vector<size_t> &mutableLineStarts();
+    size_t lineStart(size_t row) const;
+    size_t rowOf(size_t index) const;
+    void shiftLineStarts(size_t from_row, size_t delta);
+    void settleLineStarts();
+    void damageRows(size_t first, size_t last);
+    size_t getLineLength(size_t row) const;
+    void jumpTo(size_t index);
+    void buildLineStarts(const std::string &text);
+    void restore(std::vector<EditRecord> &from, std::vector<EditRecord> &to);
 
     std::vector<EditRecord> undo_stack;
     std::vector<EditRecord> redo_stack;
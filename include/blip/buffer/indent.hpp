@@ -0,0 +1,28 @@
+#pragma once
+#include <blip/buffer/table.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace buffer {
+
+// Leading-whitespace width per line, in columns. Entries are computed on first read and only
+// the lines an edit touches are forgotten; a tab width change forgets everything.
+class IndentCache {
+  public:
+    static constexpr const int32_t UNKNOWN = -1;
+    static constexpr const int32_t BLANK = -2;
+    // Lines looked at above a blank run for the width it carries; a longer run carries none.
+    static constexpr const size_t CARRY_LIMIT = 256;
+
+    void reset(size_t line_count);
+    void setTabWidth(size_t width);
+    size_t getTabWidth() const;
+    void onInsert(size_t row, size_t new_lines);
+    void onErase(size_t row, size_t removed_lines);
+    int32_t getWidth(const PieceTable &table, size_t row, size_t line_start);
+
+  private:
+    size_t tab_width = 4;
+    std::vector<int32_t> widths;
+};
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <blip/buffer/table.hpp>
+#include <vector>
+
+namespace buffer {
+
+// Byte cursor over a piece list. Steps and scans stay inside the current piece's contiguous
+// storage and only hop pieces at their edges, so walking n bytes costs O(n) with no lookups.
+// Only valid while the piece list it was created from is unchanged.
+class TextIterator {
+  public:
+    TextIterator(const std::vector<Piece> &pieces, const char *original_data, const char *add_data, size_t index);
+
+    size_t getIndex() const { return index; }
+    bool atEnd() const { return piece == pieces->size(); }
+    char get() const { return data()[offset]; }
+
+    bool next() {
+        if (atEnd()) {
+            return false;
+        }
+        index++;
+        if (++offset == (*pieces)[piece].length) {
+            piece++;
+            offset = 0;
+        }
+        return !atEnd();
+    }
+
+    bool prev() {
+        if (index == 0) {
+            return false;
+        }
+        index--;
+        if (offset > 0) {
+            offset--;
+        } else {
+            piece--;
+            offset = (*pieces)[piece].length - 1;
+        }
+        return true;
+    }
+
+    // Advances while pred holds. Returns false if it ran off the end of the text.
+    // pred is called once per byte, so it may keep state.
+    template <typename Pred> bool skipForward(Pred pred) {
+        while (!atEnd()) {
+            const char *bytes = data();
+            size_t length = (*pieces)[piece].length;
+            size_t start = offset;
+            while (offset < length && pred(bytes[offset])) {
+                offset++;
+            }
+            index += offset - start;
+            if (offset < length) {
+                return true;
+            }
+            piece++;
+            offset = 0;
+        }
+        return false;
+    }
+
+    // Steps back while pred holds for the current byte. Returns false if it stopped at index 0
+    // with pred still holding there. pred is called once per byte, so it may keep state.
+    template <typename Pred> bool skipBackward(Pred pred) {
+        if (atEnd() && !prev()) {
+            return false;
+        }
+        while (true) {
+            const char *bytes = data();
+            size_t start = offset;
+            bool stopped = false;
+            while (true) {
+                if (!pred(bytes[offset])) {
+                    stopped = true;
+                    break;
+                }
+                if (offset == 0) {
+                    break;
+                }
+                offset--;
+            }
+            index -= start - offset;
+            if (stopped) {
+                return true;
+            }
+            if (piece == 0) {
+                return false;
+            }
+            piece--;
+            offset = (*pieces)[piece].length - 1;
+            index--;
+        }
+    }
+
+  private:
+    const std::vector<Piece> *pieces;
+    const char *original_data;
+    const char *add_data;
+    size_t piece = 0;
+    size_t offset = 0;
+    size_t index = 0;
+
+    const char *data() const {
+        const Piece &p = (*pieces)[piece];
+        return (p.source == BufType::ORIGINAL ? original_data : add_data) + p.start;
+    }
+};
+}
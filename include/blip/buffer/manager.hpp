@@ -0,0 +1,53 @@
+#pragma once
+#include <blip/buffer/buffer.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace buffer {
+
+inline constexpr const size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+typedef struct {
+    std::string path;
+    std::unique_ptr<EditorBuffer> buffer;
+    size_t cursor_position;
+    uint64_t last_used;
+} BufferEntry;
+
+// Holds every open file. Buffers that have not been focused recently are evicted once the
+// resident total goes over the memory budget: they are dropped and re-read from their file,
+// keeping only the cursor. Buffers with unsaved changes or undo history would lose them, so they
+// stay resident and count against the budget.
+class BufferManager {
+  public:
+    explicit BufferManager(size_t memory_budget = DEFAULT_MEMORY_BUDGET);
+
+    size_t open(const std::string &path);
+    EditorBuffer &focus(size_t id);
+    EditorBuffer &active();
+    // Writes a buffer back to its file. Buffers opened without a path cannot be saved.
+    bool save(size_t id);
+    void focusNext();
+    void focusPrevious();
+
+    size_t getActiveId() const;
+    size_t getBufferCount() const;
+    const std::string &getPath(size_t id) const;
+    bool isResident(size_t id) const;
+    size_t getResidentBytes() const;
+    void setMemoryBudget(size_t bytes);
+    void enforceBudget();
+
+  private:
+    std::vector<BufferEntry> entries;
+    size_t active_id = 0;
+    size_t memory_budget;
+    uint64_t clock = 0;
+
+    void evict(BufferEntry &entry);
+    void materialize(BufferEntry &entry);
+};
+}
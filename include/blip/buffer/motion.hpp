@@ -0,0 +1,41 @@
+#pragma once
+#include <array>
+#include <blip/buffer/table.hpp>
+#include <cstdint>
+#include <utility>
+
+namespace buffer {
+
+enum class CharClass : uint8_t { BLANK, NEWLINE, WORD, PUNCT };
+
+constexpr std::array<CharClass, 256> makeCharClasses() {
+    std::array<CharClass, 256> classes{};
+    for (int c = 0; c < 256; c++) {
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f') {
+            classes[c] = CharClass::BLANK;
+        } else if (c == '\n') {
+            classes[c] = CharClass::NEWLINE;
+        } else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80) {
+            // Bytes of multi-byte UTF-8 sequences count as word characters, like vim's default iskeyword.
+            classes[c] = CharClass::WORD;
+        } else {
+            classes[c] = CharClass::PUNCT;
+        }
+    }
+    return classes;
+}
+
+inline constexpr const std::array<CharClass, 256> CHAR_CLASSES = makeCharClasses();
+
+inline CharClass classOf(char c, bool big_word) {
+    CharClass cls = CHAR_CLASSES[static_cast<unsigned char>(c)];
+    return big_word && cls == CharClass::PUNCT ? CharClass::WORD : cls;
+}
+
+namespace motion {
+size_t nextWordStart(const PieceTable &table, size_t index, size_t count, bool big_word);
+size_t nextWordEnd(const PieceTable &table, size_t index, size_t count, bool big_word);
+size_t prevWordStart(const PieceTable &table, size_t index, size_t count, bool big_word);
+std::pair<size_t, size_t> wordObject(const PieceTable &table, size_t index, bool around, bool big_word);
+}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <blip/buffer/iterator.hpp>
+#include <blip/buffer/table.hpp>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace buffer {
+
+// Immutable view of a buffer at one version. Holds references to the piece list, line index
+// and text storage, so it stays valid (and safe to read from another thread) while the
+// owning EditorBuffer keeps editing.
+class Snapshot {
+  public:
+    Snapshot();
+
+    uint64_t getVersion() const;
+    size_t getTotalLength() const;
+    size_t getLineCount() const;
+    size_t getLineStart(size_t row) const;
+    size_t getLineLength(size_t row) const;
+    size_t getLineFromIndex(size_t index) const;
+
+    std::string getText() const;
+    std::string getText(size_t index, size_t length) const;
+    std::string getLine(size_t row) const;
+    std::optional<char> getCharacter(size_t index) const;
+    TextIterator iteratorAt(size_t index) const;
+
+  private:
+    friend class PieceTable;
+    friend class EditorBuffer;
+
+    std::shared_ptr<const std::string> original_buffer;
+    std::shared_ptr<const std::string> add_buffer;
+    const char *original_data = nullptr;
+    const char *add_data = nullptr;
+    std::shared_ptr<const std::vector<Piece>> pieces;
+    std::shared_ptr<const std::vector<size_t>> line_starts;
+    // The buffer's unsettled line-start shift, applied on read so taking a snapshot copies nothing.
+    size_t pending_row = SIZE_MAX;
+    size_t pending_delta = 0;
+    size_t total_length = 0;
+    uint64_t version = 0;
+
+    size_t lineStart(size_t row) const;
+};
+}
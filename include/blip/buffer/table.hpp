@@ -1,7 +1,8 @@
 #pragma once
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
-#include <optional>
 
 namespace buffer {
 
@@ -13,10 +14,13 @@ typedef struct {
     size_t length;
 } Piece;
 
+class Snapshot;
+class TextIterator;
+
 class PieceTable {
   public:
     typedef struct {
-        std::vector<Piece> pieces;
+        std::shared_ptr<const std::vector<Piece>> pieces;
         size_t total_length;
     } State;
 
@@ -24,19 +28,31 @@ class PieceTable {
 
     void insert(size_t index, const std::string &text);
     void erase(size_t index, size_t length);
+    void eraseRange(size_t start, size_t end);
+    void replace(size_t offset, size_t length, const std::string &text);
 
     std::string getText() const;
     size_t getTotalLength() const;
     size_t getPieceCount() const;
+    size_t getMemoryUsage() const;
     std::optional<char> getCharacterFromCursor(size_t index, int offset = 0) const;
+    TextIterator iteratorAt(size_t index) const;
 
     State getState() const;
     void restoreState(const State &state);
+    Snapshot snapshot() const;
 
   private:
-    std::string original_buffer;
-    std::string add_buffer;
-    std::vector<Piece> pieces;
+    // Pieces and the add buffer are shared with snapshots and undo records, so they are
+    // copied on write only while someone else still holds a reference.
+    std::shared_ptr<const std::string> original_buffer;
+    std::shared_ptr<std::string> add_buffer;
+    std::shared_ptr<const std::vector<Piece>> pieces;
     size_t total_length = 0;
+
+    std::vector<Piece> &mutablePieces();
+    size_t appendToAddBuffer(const std::string &text);
+    const std::string &bufferFor(BufType source) const;
+    void splice(size_t start, size_t end, std::optional<Piece> inserted);
 };
 }
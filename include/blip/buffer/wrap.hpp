@@ -0,0 +1,150 @@
+#pragma once
+#include <array>
+#include <blip/buffer/table.hpp>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace buffer {
+
+inline constexpr const size_t WRAP_CHUNK_LINES = 1024;
+
+// Incremental UTF-8 decoding. Malformed input comes out as U+FFFD, one per offending sequence, so
+// everything that counts characters agrees with what is drawn.
+class Utf8Decoder {
+  public:
+    // emit(codepoint, index of its first byte)
+    template <typename Emit> void push(size_t index, unsigned char c, Emit &&emit) {
+        if (continuation > 0 && (c & 0xC0) == 0x80) {
+            codepoint = codepoint << 6 | (c & 0x3F);
+            if (--continuation == 0) {
+                emit(codepoint, start);
+            }
+            return;
+        }
+        if (continuation > 0) {
+            emit(0xFFFD, start);
+        }
+        start = index;
+        continuation = 0;
+        if (c < 0x80) {
+            codepoint = c;
+        } else if ((c & 0xE0) == 0xC0) {
+            codepoint = c & 0x1F;
+            continuation = 1;
+        } else if ((c & 0xF0) == 0xE0) {
+            codepoint = c & 0x0F;
+            continuation = 2;
+        } else if ((c & 0xF8) == 0xF0) {
+            codepoint = c & 0x07;
+            continuation = 3;
+        } else {
+            codepoint = 0xFFFD;
+        }
+        if (continuation == 0) {
+            emit(codepoint, start);
+        }
+    }
+
+    template <typename Emit> void finish(Emit &&emit) {
+        if (continuation > 0) {
+            emit(0xFFFD, start);
+            continuation = 0;
+        }
+    }
+
+  private:
+    uint32_t codepoint = 0;
+    size_t start = 0;
+    int continuation = 0;
+};
+
+// Greedy word wrap over the characters of one line. A row breaks after the last space that fits,
+// or before the character that overflows when the row has no space. The wrap index counts rows
+// with it and the typesetter places glyphs with it, so both always agree.
+class WordWrap {
+  public:
+    explicit WordWrap(size_t width) : width(width) {}
+
+    // Feeds the character at position index (counted in characters, not bytes) and calls
+    // onBreak(position) for every row that starts at or before it.
+    template <typename Break> void feed(size_t index, size_t cells, bool space, Break &&onBreak) {
+        if (column + cells > width && column > 0) {
+            if (last_space > row_start) {
+                row_start = last_space;
+                column -= space_column;
+                onBreak(row_start);
+            }
+            if (column + cells > width && column > 0) {
+                row_start = index;
+                column = 0;
+                onBreak(row_start);
+            }
+        }
+        column += cells;
+        if (space) {
+            last_space = index + 1;
+            space_column = column;
+        }
+    }
+
+  private:
+    size_t width;
+    size_t column = 0;
+    size_t row_start = 0;
+    size_t last_space = 0;
+    size_t space_column = 0;
+};
+
+// Visual rows per line for soft wrapping, in chunks of lines with a Fenwick tree over the line
+// and row totals of each chunk. Mapping a line to its first visual row, or a visual row back to
+// its line, costs O(log n) plus a scan of one chunk. Row counts are measured lazily: edits mark
+// only the lines they touch, and a width change just starts a new generation, keeping the old
+// counts as estimates until each line is measured again.
+class WrapIndex {
+  public:
+    // A width of 0 turns wrapping off; every line is then one row and nothing is stored.
+    void configure(size_t width, size_t tab_width, size_t line_count);
+    bool isEnabled() const;
+    size_t getWidth() const;
+
+    void onInsert(size_t row, size_t new_lines);
+    void onErase(size_t row, size_t removed_lines);
+    void invalidate(size_t line_count);
+
+    bool isMeasured(size_t row) const;
+    // Measures the line if needed. Returns its row count and whether it changed.
+    std::pair<size_t, bool> measure(const PieceTable &table, size_t row, size_t start, size_t end);
+    size_t subRowOf(const PieceTable &table, size_t start, size_t end, size_t index) const;
+
+    size_t getVisualRow(size_t row) const;
+    std::pair<size_t, size_t> locate(size_t visual_row) const;
+    size_t getRowCount() const;
+
+    // The next line the background sweep should measure, or SIZE_MAX when it has finished.
+    size_t nextUnmeasured();
+
+  private:
+    static constexpr const int LINES = 0;
+    static constexpr const int ROWS = 1;
+
+    typedef struct Chunk {
+        std::vector<uint32_t> rows;
+        std::vector<uint32_t> stamps;
+    } Chunk;
+
+    size_t width = 0;
+    size_t tab_width = 4;
+    uint32_t generation = 1;
+    size_t sweep = 0;
+    std::vector<Chunk> chunks;
+    std::vector<std::array<uint64_t, 2>> tree;
+
+    size_t count(const PieceTable &table, size_t start, size_t end, size_t stop, size_t *sub_row) const;
+    std::pair<size_t, size_t> find(int kind, uint64_t target) const;
+    uint64_t prefix(int kind, size_t chunk) const;
+    void add(size_t chunk, int64_t lines, int64_t rows);
+    void rebuildTree();
+    void split(size_t chunk);
+};
+}
@@ -97,6 +97,7 @@ namespace x {
 inline constexpr const int LINE_NUMBER = 30;
 inline constexpr const int DIAGNOSTIC = 10;
 inline constexpr const int GIT = 30;
+inline constexpr const int TEXT = 50;
 }
 namespace width {
 inline constexpr const int LINE_NUMBERS = 15;
@@ -105,6 +106,20 @@ inline constexpr const int GIT = 2;
 }
 }
 
+namespace scroll {
+inline constexpr const int WHEEL_LINES = 3;
+}
+
+namespace wrap {
+// Bytes of off-screen lines measured per frame while soft wrap catches up after a resize.
+inline constexpr const size_t MEASURE_BUDGET = 1 << 20;
+}
+
+namespace latency {
+// How often BlipDev prints its input latency histograms.
+inline constexpr const int DUMP_SECONDS = 10;
+}
+
 namespace constants {
 namespace theme {
 inline constexpr const char *BACKGROUND = "background";
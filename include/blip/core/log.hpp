@@ -1,6 +1,136 @@
 #pragma once
 #include <blip/config/editor.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+// Records below this level are compiled out: 0 trace, 1 debug, 2 info, 3 warn, 4 error, 5 off.
+// BlipDev logs from debug up, every other build from info up.
+#ifndef BLIP_LOG_LEVEL
+#ifdef _DEV_
+#define BLIP_LOG_LEVEL 1
+#else
+#define BLIP_LOG_LEVEL 2
+#endif
+#endif
+
+// BLIP_LOG(DEBUG, BUFFER, "cursor ", cursor) formats its arguments back to back into a record.
+// Below the configured level the call and its arguments are discarded at compile time.
+#define BLIP_LOG(level, category, ...)                                                                                 \
+    do {                                                                                                               \
+        if constexpr (core::LogLevel::level >= core::LOG_LEVEL) {                                                      \
+            core::Logger::get().write(core::LogLevel::level, core::LogCategory::category, __VA_ARGS__);               \
+        }                                                                                                              \
+    } while (0)
 
 namespace core {
+enum class LogLevel { TRACE, DEBUG, INFO, WARN, ERROR, OFF };
+enum class LogCategory { APP, BUFFER, CONFIG, PLATFORM, TEXT, UI };
+
+inline constexpr const LogLevel LOG_LEVEL = (LogLevel)BLIP_LOG_LEVEL;
+
+// Records are formatted on the calling thread into a slot of a fixed ring, claimed and published
+// without locks, and written out by a background thread. A full ring drops the record rather than
+// wait, so logging never blocks the thread that renders.
+class Logger {
+  public:
+    static constexpr const size_t CAPACITY = 1024;
+    static constexpr const size_t TEXT_SIZE = 240;
+
+    static Logger &get();
+
+    template <typename... Args> void write(LogLevel level, LogCategory category, const Args &...args) {
+        Slot *slot = claim();
+        if (slot == nullptr) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Record &record = slot->record;
+        record.level = level;
+        record.category = category;
+        record.time = std::chrono::steady_clock::now();
+        char *at = record.text, *end = record.text + TEXT_SIZE;
+        (append(at, end, args), ...);
+        record.length = (uint16_t)(at - record.text);
+        publish(slot);
+    }
+
+    // Blocks until every record published so far has been written.
+    void flush();
+    // Records lost to a full ring since start.
+    uint64_t getDropped() const;
+
+  private:
+    typedef struct Record {
+        LogLevel level;
+        LogCategory category;
+        std::chrono::steady_clock::time_point time;
+        uint16_t length;
+        char text[TEXT_SIZE + 1]; // room for the terminator snprintf always writes
+    } Record;
+
+    typedef struct Slot {
+        std::atomic<size_t> sequence;
+        Record record;
+    } Slot;
+
+    std::array<Slot, CAPACITY> slots;
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) size_t tail = 0;
+    uint64_t reported_dropped = 0;
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> written{0};
+    std::chrono::steady_clock::time_point started;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable drained;
+    bool running = true;
+    std::string output;
+    std::thread drainer;
+
+    Logger();
+    ~Logger();
+
+    Slot *claim();
+    void publish(Slot *slot);
+    void loop();
+    size_t drain();
+
+    static void append(char *&at, char *end, std::string_view text) {
+        size_t count = std::min<size_t>(text.size(), end - at);
+        std::memcpy(at, text.data(), count);
+        at += count;
+    }
+
+    template <typename T> static void append(char *&at, char *end, const T &value) {
+        if constexpr (std::is_same_v<T, bool>) {
+            append(at, end, value ? std::string_view("true") : std::string_view("false"));
+        } else if constexpr (std::is_same_v<T, char>) {
+            append(at, end, std::string_view(&value, 1));
+        } else if constexpr (std::is_integral_v<T>) {
+            at = std::to_chars(at, end, value).ptr;
+        } else if constexpr (std::is_floating_point_v<T>) {
+            int count = std::snprintf(at, end - at + 1, "%.3f", (double)value);
+            at = count < 0 ? at : std::min(end, at + count);
+        } else if constexpr (std::is_enum_v<T>) {
+            append(at, end, (std::underlying_type_t<T>)value);
+        } else {
+            append(at, end, std::string_view(value));
+        }
+    }
+};
+
 void printState(config::EditorConfig &state);
 }
@@ -1,6 +1,15 @@
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 namespace platform {
-std::string getTTFPath(std::string &family, std::string &style);
+std::string getTTFPath(const std::string &family, const std::string &style);
+// A font file that has a glyph for codepoint, or an empty string if none does. Slow: call it off
+// the render thread.
+std::string getFallbackPath(uint32_t codepoint);
 void readFile(const char *filename, std::string &lines);
+// The directory blip keeps caches in, which may not exist yet.
+std::string getCacheDir();
+// The most memory the process has had resident at once, in bytes.
+size_t getPeakMemory();
 }
@@ -8,11 +8,14 @@ namespace platform {
 class ConfigWatcher {
   public:
     using OnChangeCallback = std::function<void()>;
+    // Called on the watcher thread when a change is seen, so the main loop can be woken to check().
+    using WakeCallback = std::function<void()>;
     ConfigWatcher();
     ~ConfigWatcher();
-    void start(const std::string &path, OnChangeCallback callback);
+    void start(const std::string &path, OnChangeCallback callback, WakeCallback wake = nullptr);
     void stop();
-    void check();
+    // Runs the callback on the calling thread if the file changed. Returns true if it ran.
+    bool check();
 
   private:
     void loop();
@@ -21,5 +24,6 @@ class ConfigWatcher {
     std::atomic<bool> running;
     std::atomic<bool> fileDirty;
     OnChangeCallback action;
+    WakeCallback wake;
 };
 }
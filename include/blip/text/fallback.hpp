@@ -0,0 +1,78 @@
+#pragma once
+#include <SDL_ttf.h>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace text {
+// Chooses a face for every codepoint the primary font lacks. Each codepoint is looked up once:
+// the primary font and the fallback faces already open are asked first, and only if none has
+// the glyph does a background thread ask fontconfig. The same thread opens the faces fontconfig
+// names, which for large CJK or emoji fonts takes long enough to drop frames. Until both are done
+// the codepoint is drawn with the primary font, so nothing on the render path ever waits.
+class FontFallback {
+  public:
+    // wake is called on the resolver thread whenever answers are ready for poll().
+    using WakeCallback = std::function<void()>;
+
+    explicit FontFallback(WakeCallback wake);
+    ~FontFallback();
+
+    // Closes the fallback faces, which are reopened at the new size on first use. What fontconfig
+    // answered is kept.
+    void reset(TTF_Font *primary, int size);
+    TTF_Font *fontFor(Uint32 codepoint);
+    // Applies the answers and faces that arrived since the last call. Returns true and fills
+    // changed with the codepoints that now have a different face.
+    bool poll(std::vector<Uint32> &changed);
+
+  private:
+    static constexpr const uint32_t PRIMARY = 0;
+    static constexpr const uint32_t PENDING = UINT32_MAX;
+    static constexpr const uint32_t MISSING = UINT32_MAX - 1;
+
+    enum class FaceState { CLOSED, OPENING, OPEN, FAILED };
+
+    // Without a path, a fontconfig lookup for codepoint; with one, a face to open at size.
+    typedef struct Request {
+        Uint32 codepoint;
+        std::string path;
+        int size;
+    } Request;
+
+    typedef struct Answer {
+        Uint32 codepoint;
+        std::string path;
+        int size;
+        TTF_Font *font;
+    } Answer;
+
+    TTF_Font *primary = nullptr;
+    int size = 0;
+    // Codepoint to face: PRIMARY, a fallback index plus one, PENDING or MISSING.
+    std::unordered_map<Uint32, uint32_t> coverage;
+    // What fontconfig answered, in the same encoding; survives reset.
+    std::unordered_map<Uint32, uint32_t> resolved;
+    std::vector<std::string> paths;
+    std::vector<TTF_Font *> faces;
+    std::vector<FaceState> states;
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::vector<Request> requests;
+    std::vector<Answer> answers;
+    bool running = true;
+    WakeCallback wake;
+    std::thread worker;
+
+    TTF_Font *face(uint32_t entry);
+    void request(Request request);
+    void closeFaces();
+    void loop();
+};
+}
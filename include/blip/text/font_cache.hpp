@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace text {
+// Which font file a (family, style) resolved to, kept on disk so startup can open the font without
+// waiting for fontconfig. An entry is trusted only while its file still has the recorded mtime.
+// Safe to use from the refresh thread and the main thread at once.
+class FontPathCache {
+  public:
+    explicit FontPathCache(std::string file);
+
+    std::optional<std::string> lookup(const std::string &family, const std::string &style);
+    // Records the path and rewrites the file if it changed.
+    void store(const std::string &family, const std::string &style, const std::string &path);
+
+  private:
+    typedef struct Entry {
+        std::string path;
+        int64_t mtime;
+    } Entry;
+
+    std::mutex mutex;
+    std::string file;
+    bool loaded = false;
+    std::unordered_map<std::string, Entry> entries;
+
+    void load();
+    void save();
+};
+}
@@ -1,21 +1,81 @@
 #pragma once
 #include <SDL_ttf.h>
+#include <blip/text/font_cache.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace text {
+// SDL_ttf opens every face on one FreeType library, which must not open or close two faces at
+// once. Faces are opened and closed only through these, so any thread may do it.
+TTF_Font *openFont(const std::string &path, int size);
+void closeFont(TTF_Font *font);
+
+typedef struct Face {
+    TTF_Font *font;
+    uint64_t id; // stays the same while the face is open, so caches can key on it
+} Face;
+
+// Opens the configured font. A font resolved on an earlier run is opened straight from the path
+// cache while fontconfig confirms it on a background thread; if fontconfig disagrees, the worker
+// wakes the main loop and the next call to updateFont switches to its answer. Faces are kept open
+// by (path, size, style) for the most recently used few, so switching size or style back and
+// forth never reopens a file.
 class FontManager {
   public:
-    FontManager();
+    static constexpr const size_t MAX_FACES = 8;
+
+    // wake is called on the refresh thread when fontconfig has answered.
+    using WakeCallback = std::function<void()>;
+
+    explicit FontManager(WakeCallback wake);
     ~FontManager();
 
     bool updateFont(std::string &family, std::string &style, int size);
 
     TTF_Font *getFont() const;
+    // The current face's id.
+    uint64_t getGeneration() const;
 
   private:
-    TTF_Font *current_font;
+    typedef struct OpenFace {
+        std::string path, style;
+        int size;
+        Face face;
+        uint64_t used;
+    } OpenFace;
+
+    Face current;
     std::string current_family;
     std::string current_style;
+    std::string current_path;
     int current_size;
+    std::vector<OpenFace> faces;
+    uint64_t next_id;
+    uint64_t clock;
+
+    FontPathCache cache;
+    std::string refreshing_family, refreshing_style;
+
+    // A request waiting for the worker is replaced by a newer one, never waited on. Answers for a
+    // family or style that is no longer current are dropped by updateFont.
+    std::mutex refresh_mutex;
+    std::condition_variable refresh_wanted;
+    std::optional<std::pair<std::string, std::string>> refresh_request;
+    std::optional<std::pair<std::string, std::string>> refresh_answer_for;
+    std::string refresh_answer;
+    bool running = true;
+    WakeCallback wake;
+    std::thread refresher;
+
+    std::string resolve(const std::string &family, const std::string &style, bool &from_cache);
+    Face open(const std::string &path, const std::string &style, int size);
+    void startRefresh(const std::string &family, const std::string &style);
+    void refreshLoop();
 };
 }
@@ -0,0 +1,94 @@
+#pragma once
+#include <SDL_stdinc.h>
+#include <blip/buffer/snapshot.hpp>
+#include <blip/buffer/wrap.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace text {
+typedef struct FontMetrics {
+    uint64_t generation;
+    int cell_width, font_height, line_skip;
+} FontMetrics;
+
+typedef struct PositionedGlyph {
+    Uint32 codepoint;
+    Uint32 offset; // bytes from the start of the line
+    Uint32 column;
+    Uint32 cells;
+    float x;
+} PositionedGlyph;
+
+// Glyphs [first, first + count) are operator characters the font may join into a ligature.
+typedef struct LigatureRun {
+    Uint32 first, count;
+} LigatureRun;
+
+typedef struct LineLayout {
+    std::vector<PositionedGlyph> glyphs;
+    size_t columns;
+    float width;
+    std::vector<LigatureRun> runs;
+} LineLayout;
+
+// Lays buffer lines out on the cell grid. Layouts are kept in a fixed-size LRU keyed by a hash of
+// the line's bytes and the layout generation, so an edit re-lays out only the lines whose bytes
+// changed. Evicted slots keep their vectors' capacity, so once the cache is warm no frame allocates.
+class Typesetter {
+  public:
+    static constexpr const size_t DEFAULT_CAPACITY = 1024;
+    static constexpr const size_t MAX_LIGATURE_RUN = 8;
+
+    explicit Typesetter(size_t capacity = DEFAULT_CAPACITY);
+
+    // Any change to the font, tab width, line height or ligatures starts a new generation; stale
+    // layouts are never hit again and age out of the cache. Returns true if a new generation
+    // started. Ligature runs are only found when ligatures are on; lines without one are drawn
+    // glyph by glyph and never shaped.
+    bool configure(const FontMetrics &metrics, size_t tab_width, float line_height, bool ligatures = false);
+    int getLineHeight() const;
+    int getBaseline() const;
+    int getCellWidth() const;
+    size_t getTabWidth() const;
+    size_t getCapacity() const;
+
+    // Reads only the snapshot, so layout can run off the thread that edits the buffer.
+    const LineLayout &layout(const buffer::Snapshot &snapshot, size_t row);
+    // A pinned layout is never evicted, so another thread can keep reading it; pins are counted.
+    // Fewer layouts than the capacity may be pinned at once.
+    void pin(const LineLayout &layout);
+    void unpin(const LineLayout &layout);
+    // The glyph index each row starts at when the line wraps at width columns (0 for no wrap).
+    // Breaks where buffer::WrapIndex counts them.
+    void wrap(const LineLayout &line, size_t width, std::vector<size_t> &rows) const;
+
+  private:
+    static constexpr const uint32_t NONE = UINT32_MAX;
+
+    // Slot i holds layouts[i]; the layouts are kept apart so the LRU links can change while
+    // another thread reads a pinned layout.
+    typedef struct Slot {
+        uint64_t key = 0;
+        uint32_t prev = NONE, next = NONE, chain = NONE;
+        uint32_t pins = 0;
+        bool used = false;
+    } Slot;
+
+    FontMetrics metrics = {0, 0, 0, 0};
+    size_t tab_width = 4;
+    float line_height = 1.0f;
+    bool ligatures = false;
+    uint64_t generation = 0;
+
+    std::vector<Slot> slots;
+    std::vector<LineLayout> layouts;
+    std::vector<uint32_t> buckets;
+    uint32_t head = NONE, tail = NONE;
+
+    void unlink(uint32_t index);
+    void pushFront(uint32_t index);
+    void unchain(uint32_t index);
+    void build(const buffer::Snapshot &snapshot, size_t start, size_t end, LineLayout &out);
+    void findRuns(LineLayout &out) const;
+};
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <blip/text/fallback.hpp>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ui {
+typedef struct Glyph {
+    SDL_Rect source;
+    int advance;
+} Glyph;
+
+// Every glyph of the current font is rasterized once into a single packed texture and drawn as
+// textured quads, so a frame of text costs one SDL_RenderGeometry call and no texture uploads.
+class GlyphAtlas {
+  public:
+    GlyphAtlas();
+    ~GlyphAtlas();
+
+    // Drops every cached glyph and rasterizes printable ASCII with the new font. Call only when
+    // the font actually changed.
+    void reset(SDL_Renderer *renderer, TTF_Font *font);
+    bool isReady() const;
+    // Glyphs the font lacks are rasterized from the face the fallback chooses.
+    void setFallback(text::FontFallback *fallback);
+    // Drops the given glyphs so they are rasterized again, from whatever face now covers them.
+    void forget(const std::vector<Uint32> &codepoints);
+
+    // Rasterizes the codepoint on first use. May flush queued quads if the texture has to grow.
+    const Glyph *get(Uint32 codepoint);
+    // A run of text shaped as a whole, so the font's ligatures apply, and packed like a glyph.
+    // Shaped once per run for the current font.
+    const Glyph *getRun(const std::string &text);
+    int getCellWidth() const;
+    int getFontHeight() const;
+    int getLineSkip() const;
+
+    // Queued quads are tinted with color and drawn by the next flush.
+    void queue(const Glyph &glyph, float x, float y, SDL_Color color);
+    void flush();
+
+  private:
+    SDL_Renderer *renderer;
+    TTF_Font *font;
+    text::FontFallback *fallback;
+    SDL_Texture *texture;
+    int size;
+    int shelf_x, shelf_y, shelf_height;
+    int cell_width, font_height, line_skip;
+
+    std::array<Glyph, 128> ascii;
+    std::array<bool, 128> ascii_ready;
+    std::unordered_map<Uint32, Glyph> glyphs;
+    std::unordered_map<std::string, Glyph> runs;
+
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+
+    void createTexture(int new_size);
+    void clearGlyphs();
+    bool rasterize(Uint32 codepoint, Glyph &glyph);
+    bool upload(SDL_Surface *rendered, Glyph &glyph);
+    bool pack(int width, int height, SDL_Rect &rect);
+};
+
+// One atlas per recently used face, keyed by the face's id, so switching size or style back and
+// forth reuses the glyphs already rasterized instead of starting over.
+class AtlasCache {
+  public:
+    explicit AtlasCache(size_t capacity);
+
+    // The atlas for the face, filled with printable ASCII on first use. Past capacity the least
+    // recently used atlas is dropped.
+    GlyphAtlas &get(SDL_Renderer *renderer, TTF_Font *font, uint64_t id, text::FontFallback *fallback);
+    void forget(const std::vector<Uint32> &codepoints);
+
+  private:
+    typedef struct Entry {
+        uint64_t id, used;
+        std::unique_ptr<GlyphAtlas> atlas;
+    } Entry;
+
+    size_t capacity;
+    uint64_t clock = 0;
+    std::vector<Entry> entries;
+};
+
+// Glyph uploads to atlas textures since start, over every atlas.
+uint64_t getTextureUploads();
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <SDL.h>
+#include <blip/app/main.hpp>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace ui {
+
+// Buffer rows that must be repainted this frame. Rows reach across the gutter and the whole
+// window width, so a damaged row also repaints its line number and cursor; an open-ended span
+// (last == SIZE_MAX) repaints to the bottom of the window.
+class Damage {
+  public:
+    void addRows(size_t first, size_t last);
+    void addRow(size_t row);
+    void addAll();
+    void add(const Damage &other);
+    bool isEmpty() const;
+    bool isFull() const;
+    // Sorted, non-overlapping spans of [first, last) rows.
+    const std::vector<std::pair<size_t, size_t>> &getSpans() const;
+    void clear();
+
+  private:
+    bool full = false;
+    std::vector<std::pair<size_t, size_t>> spans;
+};
+
+// The window contents kept in a target texture between frames, so a frame only repaints what is
+// damaged and then copies the whole canvas to the screen. Whatever is drawn between compose and
+// present lands on top of the frame without entering the canvas.
+class Canvas {
+  public:
+    ~Canvas();
+
+    // Makes the canvas the render target, recreating it if the window size changed. Returns false
+    // when the previous contents are gone and everything has to be repainted.
+    bool begin(app::AppState &appState);
+    // Copies the canvas to the window.
+    void compose(app::AppState &appState);
+    void present(app::AppState &appState);
+    // Target textures are lost on SDL_RENDER_TARGETS_RESET and SDL_RENDER_DEVICE_RESET.
+    void invalidate();
+
+  private:
+    SDL_Texture *texture = nullptr;
+    int width = 0, height = 0;
+    bool valid = false;
+};
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <blip/buffer/snapshot.hpp>
+#include <blip/text/typesetter.hpp>
+#include <blip/ui/damage.hpp>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace ui {
+typedef struct ScopeGuide {
+    size_t column, top, bottom;
+} ScopeGuide;
+
+// Everything drawn on top of the text that can move without the text changing.
+typedef struct Overlays {
+    size_t cursor, cursor_row;
+    std::optional<size_t> match;
+    size_t match_row;
+    std::optional<ScopeGuide> scope;
+} Overlays;
+
+// One visual row. start is where its line begins, and end is where its line ends on the line's last
+// row only; other rows of a wrapped line have SIZE_MAX there. The row draws glyphs [from, to) of its
+// line's cached layout, shift columns further left, so each row of a wrapped line starts again at
+// the left edge.
+typedef struct DrawRow {
+    size_t row, start, end;
+    size_t indent; // guide width in columns, carried through blank lines
+    bool blank;
+    const text::LineLayout *layout;
+    size_t from, to;
+    size_t shift, columns;
+} DrawRow;
+
+// One frame, laid out from a snapshot. Published lists are never modified, so the SDL thread can
+// paint one while the worker builds the next. sequence is that of the job it was laid out from.
+// The layouts its rows point into stay pinned in the worker's cache until the list is reused.
+typedef struct DrawList {
+    uint64_t sequence;
+    size_t first_row;
+    int pixel_offset;
+    int cell_width, line_height, baseline;
+    size_t tab_width;
+    std::vector<DrawRow> rows;
+    std::vector<const text::LineLayout *> pinned;
+    Overlays overlays;
+    Damage damage;
+    std::chrono::steady_clock::time_point laid_out;
+} DrawList;
+
+// Rows are visual rows; the first one is row sub_row of line first_line. A wrap width of 0 lays
+// every line out on one row. carried_indent is the guide width blank lines at the top carry in from
+// above. Jobs are numbered in the order they are submitted.
+typedef struct LayoutJob {
+    uint64_t sequence;
+    buffer::Snapshot snapshot;
+    size_t first_row, row_count;
+    size_t first_line, sub_row;
+    size_t carried_indent;
+    size_t wrap_width;
+    int pixel_offset;
+    text::FontMetrics metrics;
+    size_t tab_width;
+    float line_height;
+    bool ligatures;
+    Overlays overlays;
+    Damage damage;
+} LayoutJob;
+
+// Lays frames out on a background thread from buffer snapshots and pre-captured font metrics; it
+// never touches SDL or TTF. A job submitted while another is still waiting replaces it and takes
+// over its damage, so a slow layout delays the picture but never the input behind it. Draw lists
+// come from a fixed pool and keep their capacity, so once warm, laying out a frame allocates
+// nothing.
+class LayoutWorker {
+  public:
+    using WakeCallback = std::function<void()>;
+    // One list being built, one finished and waiting, and one the SDL thread is painting.
+    static constexpr const size_t LISTS = 3;
+
+    // wake is called on the worker thread whenever a draw list is ready.
+    explicit LayoutWorker(WakeCallback wake);
+    ~LayoutWorker();
+
+    void submit(LayoutJob job);
+    // The newest finished draw list, or nullptr if none finished since the last call.
+    std::shared_ptr<const DrawList> take();
+
+  private:
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::optional<LayoutJob> pending;
+    std::shared_ptr<const DrawList> finished;
+    bool running = true;
+    WakeCallback wake;
+    text::Typesetter typesetter;
+    std::vector<size_t> breaks;
+    std::array<std::shared_ptr<DrawList>, LISTS> lists;
+    std::thread worker;
+
+    void loop();
+    std::shared_ptr<DrawList> reuse();
+    std::shared_ptr<DrawList> build(LayoutJob &job);
+};
+}
@@ -4,9 +4,28 @@
 #include <blip/app/main.hpp>
 #include <blip/buffer/buffer.hpp>
 #include <blip/config/editor.hpp>
-#include <blip/text/font_manager.hpp>
+#include <blip/text/typesetter.hpp>
+#include <blip/ui/atlas.hpp>
+#include <blip/ui/damage.hpp>
+#include <blip/ui/layout.hpp>
+#include <blip/ui/viewport.hpp>
+#include <string>
+#include <vector>
 
 namespace ui {
-void drawEditor(app::AppState &appState, config::EditorConfig &state, text::FontManager &fonts);
+Overlays findOverlays(app::AppState &appState, config::EditorConfig &state, text::Typesetter &typesetter,
+                      const Viewport &viewport, buffer::EditorBuffer &buffer);
+void damageOverlays(Damage &damage, const Overlays &before, const Overlays &after);
+
+// Paints the damaged rows of a draw list, or all of it when full is set.
+void drawFrame(app::AppState &appState, config::EditorConfig &state, GlyphAtlas &atlas, const DrawList &list,
+               bool full);
+void drawEditor(app::AppState &appState, config::EditorConfig &state, GlyphAtlas &atlas, const DrawList &list,
+                size_t first_row, size_t last_row);
 void drawBackground(app::AppState &appState, config::EditorConfig &state);
+void drawIndentGuides(app::AppState &appState, config::EditorConfig &state, const DrawList &list, size_t first_row,
+                      size_t last_row);
+// A box of text in the bottom right corner, drawn straight to the window after Canvas::compose.
+void drawStatsOverlay(app::AppState &appState, config::EditorConfig &state, GlyphAtlas &atlas,
+                      const std::vector<std::string> &lines);
 }
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+
+namespace ui {
+
+// The window onto a buffer: the first visible row and how many pixels of it are scrolled out of
+// view. Rows are visual rows, which are the lines unless soft wrap is on. Every frame derives the
+// rows to lay out and draw from these and the window height, so the cost of a frame does not
+// depend on the length of the document.
+class Viewport {
+  public:
+    size_t getTopLine() const;
+    int getPixelOffset() const;
+    // Rows that are at least partly on screen, starting at the top line.
+    size_t getVisibleRows(int window_height, int line_height) const;
+
+    void scrollBy(int pixels, int line_height, size_t line_count);
+    // Moves the top row but keeps the pixel offset, for when the rows above it were re-measured.
+    void setTopLine(size_t row);
+    // Scrolls as little as possible to bring row fully into view.
+    void reveal(size_t row, int window_height, int line_height);
+
+  private:
+    size_t top_line = 0;
+    int pixel_offset = 0;
+};
+}
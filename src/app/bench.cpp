@@ -0,0 +1,215 @@
+#include <blip/app/bench.hpp>
+#include <blip/app/trace.hpp>
+#include <blip/platform/system.hpp>
+#include <blip/ui/atlas.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace app {
+namespace {
+// Words a typical source file is made of, so lines have realistic lengths, indents and operators.
+constexpr const char *WORDS[] = {"if", "(value", "!=", "nullptr)", "{", "return", "result;", "}", "auto", "index",
+                                 "=", "buffer.getLineStart(row);", "for", "(size_t", "i", "<", "count;", "i++)",
+                                 "//", "comment", "->", "std::vector<int>", "&&", "||"};
+constexpr size_t WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+constexpr size_t TYPED_LINE = 40;
+constexpr size_t JUMP_EVERY = 200;
+
+std::optional<size_t> parseSize(const std::string &text) {
+    size_t used = 0;
+    unsigned long long value;
+    try {
+        value = std::stoull(text, &used);
+    } catch (...) {
+        return std::nullopt;
+    }
+    std::string suffix = text.substr(used);
+    if (suffix == "K" || suffix == "k") {
+        value <<= 10;
+    } else if (suffix == "M" || suffix == "m") {
+        value <<= 20;
+    } else if (suffix == "G" || suffix == "g") {
+        value <<= 30;
+    } else if (!suffix.empty()) {
+        return std::nullopt;
+    }
+    return (size_t)value;
+}
+
+double milliseconds(Uint64 ticks) { return ticks * 1000.0 / SDL_GetPerformanceFrequency(); }
+
+double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    return sorted[std::min(sorted.size() - 1, (size_t)(p * (sorted.size() - 1) + 0.5))];
+}
+}
+
+std::atomic<uint64_t> Bench::allocations{0};
+
+Bench::Bench(Workload workload, size_t steps) : workload(workload), steps(steps) { frame_ms.reserve(steps); }
+
+Bench::Bench(std::vector<SDL_Event> trace)
+    : workload(Workload::REPLAY), steps(trace.size()), trace(std::move(trace)) {
+    frame_ms.reserve(steps);
+}
+
+std::optional<Bench> Bench::fromArgs(int argc, char *argv[], std::string &file) {
+    if (argc < 3) {
+        return std::nullopt;
+    }
+    std::string name = argv[1];
+    if (name == "replay") {
+        if (argc < 4) {
+            return std::nullopt;
+        }
+        auto events = loadTrace(argv[2]);
+        if (!events) {
+            std::cerr << "Not a trace file: " << argv[2] << std::endl;
+            return std::nullopt;
+        }
+        auto size = parseSize(argv[3]);
+        file = size ? generateFile(*size) : argv[3];
+        return Bench(std::move(*events));
+    }
+
+    auto size = parseSize(argv[2]);
+    auto count = argc >= 4 ? parseSize(argv[3]) : DEFAULT_STEPS;
+    if ((name != "scroll" && name != "edit") || !size || !count) {
+        return std::nullopt;
+    }
+    file = generateFile(*size);
+    return Bench(name == "scroll" ? Workload::SCROLL : Workload::EDIT, *count);
+}
+
+std::string Bench::generateFile(size_t bytes) {
+    auto path = std::filesystem::temp_directory_path() / ("blip-bench-" + std::to_string(bytes) + ".txt");
+    std::error_code error;
+    if (std::filesystem::exists(path, error) && std::filesystem::file_size(path, error) == bytes) {
+        return path.string();
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    uint64_t state = 1;
+    std::string line;
+    size_t written = 0;
+    while (written < bytes) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        line.assign((state >> 60) % 4 * 4, ' ');
+        size_t words = 1 + (state >> 32) % 12;
+        for (size_t w = 0; w < words; w++) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            line += WORDS[(state >> 33) % WORD_COUNT];
+            line += ' ';
+        }
+        line.back() = '\n';
+        line.resize(std::min(line.size(), bytes - written));
+        out << line;
+        written += line.size();
+    }
+    return path.string();
+}
+
+void Bench::next(buffer::EditorBuffer &buffer, FrameScheduler &scheduler) {
+    if (phase != Phase::IDLE) {
+        return;
+    }
+    if (step == steps) {
+        phase = Phase::DONE;
+        SDL_Event quit;
+        SDL_zero(quit);
+        quit.type = SDL_QUIT;
+        SDL_PushEvent(&quit);
+        return;
+    }
+
+    phase = Phase::QUEUED;
+    started = SDL_GetPerformanceCounter();
+    started_allocations = allocations.load(std::memory_order_relaxed);
+    started_uploads = ui::getTextureUploads();
+    if (step == 0) {
+        began = started;
+    }
+    if (workload == Workload::REPLAY) {
+        SDL_PushEvent(&trace[step]);
+    } else if (workload == Workload::SCROLL) {
+        // Down through the file for the first half of the steps, then back up.
+        SDL_Event wheel;
+        SDL_zero(wheel);
+        wheel.type = SDL_MOUSEWHEEL;
+        wheel.wheel.y = step < steps / 2 ? -1 : 1;
+        SDL_PushEvent(&wheel);
+    } else {
+        // Typing, a new line every so often, and now and then a jump elsewhere in the file.
+        if (step % JUMP_EVERY == 0) {
+            buffer.gotoLine(random() % buffer.getLineCount());
+            buffer.commit();
+        }
+        if (step % TYPED_LINE == TYPED_LINE - 1) {
+            buffer.insertText("\n");
+            buffer.commit();
+        } else {
+            buffer.insertText(std::string(1, (char)('a' + step % 26)));
+        }
+        scheduler.wake();
+    }
+    step++;
+}
+
+void Bench::submitted(uint64_t sequence) {
+    if (phase == Phase::QUEUED) {
+        target = sequence;
+        phase = Phase::DRAWING;
+    }
+}
+
+void Bench::presented(uint64_t sequence) {
+    if (phase == Phase::WARMUP) {
+        phase = Phase::IDLE;
+    }
+    if (phase == Phase::DRAWING && sequence >= target) {
+        finish(true);
+    }
+}
+
+void Bench::endPass() {
+    if (phase == Phase::QUEUED) {
+        finish(false);
+    }
+}
+
+void Bench::report(std::ostream &out) const {
+    std::vector<double> sorted = frame_ms;
+    std::sort(sorted.begin(), sorted.end());
+    double per_frame = frames ? 1.0 / frames : 0.0;
+    out << std::fixed << std::setprecision(3);
+    const char *name = workload == Workload::SCROLL ? "scroll" : workload == Workload::EDIT ? "edit" : "replay";
+    out << "BlipBench " << name << ": " << frame_ms.size() << " steps, " << frames << " frames in "
+        << milliseconds(ended - began) << " ms\n";
+    out << (workload == Workload::REPLAY ? "  event time ms   p50 " : "  frame time ms   p50 ") << percentile(sorted, 0.50) << "  p95 " << percentile(sorted, 0.95) << "  p99 "
+        << percentile(sorted, 0.99) << "  max " << (sorted.empty() ? 0.0 : sorted.back()) << "\n";
+    out << "  allocations     " << total_allocations << " (" << total_allocations * per_frame << " per frame)\n";
+    out << "  texture uploads " << total_uploads << " (" << total_uploads * per_frame << " per frame)\n";
+    out << "  peak memory     " << platform::getPeakMemory() / (1 << 20) << " MB" << std::endl;
+}
+
+void Bench::finish(bool drawn) {
+    ended = SDL_GetPerformanceCounter();
+    frame_ms.push_back(milliseconds(ended - started));
+    total_allocations += allocations.load(std::memory_order_relaxed) - started_allocations;
+    total_uploads += ui::getTextureUploads() - started_uploads;
+    frames += drawn;
+    phase = Phase::IDLE;
+}
+
+uint64_t Bench::random() {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return seed;
+}
+}
@@ -0,0 +1,119 @@
+#include <blip/app/keymap.hpp>
+
+namespace app {
+
+namespace {
+enum : Uint16 { MOD_CTRL = 1, MOD_SHIFT = 2, MOD_ALT = 4, MOD_GUI = 8 };
+}
+
+Keymap::Keymap() : nodes(static_cast<size_t>(InputMode::COUNT), Node{Action::NONE, false}) {}
+
+Uint16 Keymap::normalize(Uint16 modifiers) {
+    Uint16 mods = 0;
+    if (modifiers & KMOD_CTRL)
+        mods |= MOD_CTRL;
+    if (modifiers & KMOD_SHIFT)
+        mods |= MOD_SHIFT;
+    if (modifiers & KMOD_ALT)
+        mods |= MOD_ALT;
+    if (modifiers & KMOD_GUI)
+        mods |= MOD_GUI;
+    return mods;
+}
+
+uint64_t Keymap::edgeKey(uint32_t node, Uint16 modifiers, SDL_Keycode key) {
+    return static_cast<uint64_t>(node) << 36 | static_cast<uint64_t>(modifiers) << 32 | static_cast<uint32_t>(key);
+}
+
+void Keymap::bind(InputMode mode, std::initializer_list<config::Shortcut> keys, Action action) {
+    uint32_t node = static_cast<uint32_t>(mode);
+    for (const auto &key : keys) {
+        auto [it, inserted] = edges.try_emplace(edgeKey(node, normalize(key.modifiers), key.key), nodes.size());
+        if (inserted) {
+            nodes.push_back(Node{Action::NONE, false});
+        }
+        nodes[node].has_children = true;
+        node = it->second;
+    }
+    nodes[node].action = action;
+}
+
+void Keymap::bindAll(std::initializer_list<config::Shortcut> keys, Action action) {
+    for (size_t mode = 0; mode < static_cast<size_t>(InputMode::COUNT); mode++) {
+        bind(static_cast<InputMode>(mode), keys, action);
+    }
+}
+
+std::shared_ptr<const Keymap> Keymap::compile(const config::EditorConfig &state) {
+    std::shared_ptr<Keymap> keymap(new Keymap());
+    auto &k = *keymap;
+
+    k.bindAll({{KMOD_CTRL, SDLK_TAB}}, Action::NEXT_BUFFER);
+    k.bindAll({{KMOD_CTRL | KMOD_SHIFT, SDLK_TAB}}, Action::PREVIOUS_BUFFER);
+
+    k.bind(InputMode::NORMAL, {{0, SDLK_u}}, Action::UNDO);
+    k.bind(InputMode::NORMAL, {{KMOD_CTRL, SDLK_r}}, Action::REDO);
+    k.bind(InputMode::NORMAL, {{0, SDLK_h}}, Action::MOVE_LEFT);
+    k.bind(InputMode::NORMAL, {{0, SDLK_BACKSPACE}}, Action::MOVE_LEFT);
+    k.bind(InputMode::NORMAL, {{0, SDLK_l}}, Action::MOVE_RIGHT);
+    k.bind(InputMode::NORMAL, {{0, SDLK_k}}, Action::MOVE_UP);
+    k.bind(InputMode::NORMAL, {{0, SDLK_j}}, Action::MOVE_DOWN);
+    k.bind(InputMode::NORMAL, {{0, SDLK_RETURN}}, Action::MOVE_DOWN);
+    k.bind(InputMode::NORMAL, {{0, SDLK_KP_ENTER}}, Action::MOVE_DOWN);
+    k.bind(InputMode::NORMAL, {{0, SDLK_g}, {0, SDLK_g}}, Action::GOTO_FIRST_LINE);
+    k.bind(InputMode::NORMAL, {{KMOD_SHIFT, SDLK_g}}, Action::GOTO_LAST_LINE);
+
+    for (auto mode : {InputMode::INSERT, InputMode::EDIT}) {
+        k.bind(mode, {{0, SDLK_LEFT}}, Action::MOVE_LEFT);
+        k.bind(mode, {{0, SDLK_RIGHT}}, Action::MOVE_RIGHT);
+        k.bind(mode, {{0, SDLK_UP}}, Action::MOVE_UP);
+        k.bind(mode, {{0, SDLK_DOWN}}, Action::MOVE_DOWN);
+        k.bind(mode, {{0, SDLK_SPACE}}, Action::COMMIT);
+        k.bind(mode, {{0, SDLK_RETURN}}, Action::NEWLINE);
+        k.bind(mode, {{0, SDLK_KP_ENTER}}, Action::NEWLINE);
+        k.bind(mode, {{0, SDLK_BACKSPACE}}, Action::DELETE_BACKWARD);
+    }
+    k.bind(InputMode::EDIT, {{KMOD_CTRL, SDLK_z}}, Action::UNDO);
+    k.bind(InputMode::EDIT, {{KMOD_GUI, SDLK_z}}, Action::UNDO);
+    k.bind(InputMode::EDIT, {{KMOD_CTRL, SDLK_r}}, Action::REDO);
+    k.bind(InputMode::EDIT, {{KMOD_GUI, SDLK_r}}, Action::REDO);
+
+    for (auto mode : {InputMode::INSERT, InputMode::VISUAL, InputMode::REPLACE}) {
+        k.bind(mode, {{0, SDLK_ESCAPE}}, Action::ENTER_NORMAL);
+    }
+
+    // Configured shortcuts are bound last so they take precedence over the built-in keys. The
+    // search and split shortcuts stay unbound until those actions exist.
+    k.bindAll({state.input.shortcut_save}, Action::SAVE);
+    return keymap;
+}
+
+Action Keymap::dispatch(KeySequence &sequence, InputMode mode, Uint16 modifiers, SDL_Keycode key) const {
+    // Modifier presses arrive as keys of their own and must not break a pending sequence
+    if (key >= SDLK_LCTRL && key <= SDLK_RGUI) {
+        return Action::NONE;
+    }
+    if (sequence.keymap != this || sequence.mode != mode) {
+        sequence = KeySequence{this, mode, 0};
+    }
+    Uint16 mods = normalize(modifiers);
+    auto it = edges.end();
+    if (sequence.node != 0) {
+        it = edges.find(edgeKey(sequence.node, mods, key));
+        sequence.node = 0;
+    }
+    // A key that does not continue the sequence abandons it and is looked up on its own
+    if (it == edges.end()) {
+        it = edges.find(edgeKey(static_cast<uint32_t>(mode), mods, key));
+        if (it == edges.end()) {
+            return Action::NONE;
+        }
+    }
+    const Node &node = nodes[it->second];
+    if (node.has_children) {
+        sequence.node = it->second;
+        return Action::PENDING;
+    }
+    return node.action;
+}
+}
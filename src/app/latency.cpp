@@ -0,0 +1,171 @@
+#include <blip/app/latency.hpp>
+#include <blip/core/log.hpp>
+#include <algorithm>
+#include <bit>
+#include <iomanip>
+#include <sstream>
+
+namespace app {
+namespace {
+constexpr const char *KIND_NAMES[] = {"key", "text", "wheel", "click"};
+constexpr const char *STAGE_NAMES[] = {"input", "prepare", "layout", "draw", "present", "total"};
+constexpr const char *STAGE_SHORT_NAMES[] = {"in", "prep", "lay", "draw", "pres", "all"};
+
+// Values below SUB_BUCKETS get a bucket each; above, each power of two is split into SUB_BUCKETS.
+constexpr size_t SUB_BITS = 3;
+constexpr size_t SUB_BUCKETS = (size_t)1 << SUB_BITS;
+
+size_t bucketOf(uint64_t micros) {
+    if (micros < SUB_BUCKETS) {
+        return micros;
+    }
+    size_t shift = std::bit_width(micros) - 1 - SUB_BITS;
+    return (shift + 1) * SUB_BUCKETS + ((micros >> shift) & (SUB_BUCKETS - 1));
+}
+
+// The middle of the bucket, in microseconds.
+double valueOf(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return (double)bucket;
+    }
+    size_t shift = bucket / SUB_BUCKETS - 1;
+    uint64_t low = (uint64_t)(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    return low + ((uint64_t)1 << shift) / 2.0;
+}
+}
+
+void LatencyHistogram::add(LatencyClock::duration duration) {
+    uint64_t micros = (uint64_t)std::max<int64_t>(
+        0, std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+    buckets[std::min(bucketOf(micros), buckets.size() - 1)]++;
+    count++;
+    max = std::max(max, micros);
+}
+
+uint64_t LatencyHistogram::getCount() const { return count; }
+
+double LatencyHistogram::percentile(double p) const {
+    if (count == 0) {
+        return 0.0;
+    }
+    uint64_t rank = (uint64_t)(p * (count - 1)), seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen > rank) {
+            return std::min(valueOf(i), (double)max) / 1000.0;
+        }
+    }
+    return max / 1000.0;
+}
+
+double LatencyHistogram::getMax() const { return max / 1000.0; }
+
+std::optional<InputKind> LatencyTracker::kindOf(const SDL_Event &event) {
+    switch (event.type) {
+    case SDL_KEYDOWN:
+        return InputKind::KEY;
+    case SDL_TEXTINPUT:
+        return InputKind::TEXT;
+    case SDL_MOUSEWHEEL:
+        return InputKind::WHEEL;
+    case SDL_MOUSEBUTTONDOWN:
+        return InputKind::CLICK;
+    default:
+        return std::nullopt;
+    }
+}
+
+// SDL stamps events in milliseconds when it queues them, so time spent waiting in the queue while
+// the loop was busy counts too.
+void LatencyTracker::delivered(const SDL_Event &event) {
+    auto kind = kindOf(event);
+    if (!kind) {
+        return;
+    }
+    auto now = LatencyClock::now();
+    Uint32 ticks = SDL_GetTicks();
+    Uint32 queued = event.common.timestamp != 0 && event.common.timestamp <= ticks ? ticks - event.common.timestamp : 0;
+    pass.push_back({*kind, now - std::chrono::milliseconds(queued), {}, {}, 0});
+}
+
+void LatencyTracker::applied() {
+    auto now = LatencyClock::now();
+    for (Input &input : pass) {
+        input.applied = now;
+    }
+}
+
+void LatencyTracker::submitted(uint64_t sequence) {
+    auto now = LatencyClock::now();
+    for (Input &input : pass) {
+        input.submitted = now;
+        input.sequence = sequence;
+        in_flight.push_back(input);
+    }
+    pass.clear();
+}
+
+void LatencyTracker::endPass() { pass.clear(); }
+
+void LatencyTracker::presented(uint64_t sequence, LatencyClock::time_point laid_out, LatencyClock::time_point drawn) {
+    auto now = LatencyClock::now();
+    size_t shown = 0;
+    for (; shown < in_flight.size() && in_flight[shown].sequence <= sequence; shown++) {
+        const Input &input = in_flight[shown];
+        auto &stages = histograms[(size_t)input.kind];
+        stages[(size_t)LatencyStage::INPUT].add(input.applied - input.delivered);
+        stages[(size_t)LatencyStage::PREPARE].add(input.submitted - input.applied);
+        stages[(size_t)LatencyStage::LAYOUT].add(laid_out - input.submitted);
+        stages[(size_t)LatencyStage::DRAW].add(drawn - laid_out);
+        stages[(size_t)LatencyStage::PRESENT].add(now - drawn);
+        stages[(size_t)LatencyStage::TOTAL].add(now - input.delivered);
+    }
+    in_flight.erase(in_flight.begin(), in_flight.begin() + shown);
+}
+
+std::vector<std::string> LatencyTracker::summarize() const {
+    std::vector<std::string> lines;
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(1);
+    for (size_t kind = 0; kind < (size_t)InputKind::COUNT; kind++) {
+        const auto &stages = histograms[kind];
+        const LatencyHistogram &total = stages[(size_t)LatencyStage::TOTAL];
+        if (total.getCount() == 0) {
+            continue;
+        }
+        line.str("");
+        line << std::left << std::setw(6) << KIND_NAMES[kind] << std::right << "p50 " << std::setw(5)
+             << total.percentile(0.50) << " p95 " << std::setw(5) << total.percentile(0.95) << " p99 " << std::setw(5)
+             << total.percentile(0.99) << " |";
+        for (size_t stage = 0; stage < (size_t)LatencyStage::TOTAL; stage++) {
+            line << " " << STAGE_SHORT_NAMES[stage] << " " << stages[stage].percentile(0.95);
+        }
+        lines.push_back(line.str());
+    }
+    return lines;
+}
+
+void LatencyTracker::dump() const {
+    BLIP_LOG(DEBUG, APP, "Input latency in ms, from SDL delivery to present:");
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(2);
+    for (size_t kind = 0; kind < (size_t)InputKind::COUNT; kind++) {
+        const auto &stages = histograms[kind];
+        if (stages[(size_t)LatencyStage::TOTAL].getCount() == 0) {
+            continue;
+        }
+        BLIP_LOG(DEBUG, APP, "  ", KIND_NAMES[kind], " (", stages[(size_t)LatencyStage::TOTAL].getCount(), " events)");
+        for (size_t stage = 0; stage < (size_t)LatencyStage::COUNT; stage++) {
+            const LatencyHistogram &histogram = stages[stage];
+            line.str("");
+            line << "    " << std::left << std::setw(8) << STAGE_NAMES[stage] << std::right << " p50 " << std::setw(7)
+                 << histogram.percentile(0.50) << "  p95 " << std::setw(7) << histogram.percentile(0.95) << "  p99 "
+                 << std::setw(7) << histogram.percentile(0.99) << "  max " << std::setw(7) << histogram.getMax();
+            BLIP_LOG(DEBUG, APP, line.str());
+        }
+    }
+    if (uint64_t dropped = core::Logger::get().getDropped()) {
+        BLIP_LOG(DEBUG, APP, "Log records dropped to a full ring: ", dropped);
+    }
+}
+}
@@ -1,17 +1,33 @@
 #include <SDL.h>
 #include <SDL_ttf.h>
+#include <blip/app/bench.hpp>
+#include <blip/app/keymap.hpp>
+#include <blip/app/latency.hpp>
 #include <blip/app/main.hpp>
+#include <blip/app/scheduler.hpp>
+#include <blip/app/trace.hpp>
 #include <blip/buffer/buffer.hpp>
+#include <blip/buffer/manager.hpp>
 #include <blip/buffer/table.hpp>
 #include <blip/config/editor.hpp>
 #include <blip/core/log.hpp>
 #include <blip/platform/system.hpp>
 #include <blip/platform/watcher.hpp>
+#include <blip/text/fallback.hpp>
 #include <blip/text/font_manager.hpp>
 #include <blip/ui/renderer.hpp>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <new>
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #ifdef _DEV_
 #define DEV(...) __VA_ARGS__
@@ -19,6 +35,59 @@
 #define DEV(...)
 #endif
 
+#ifdef _BENCH_
+#define BENCH(...) __VA_ARGS__
+#else
+#define BENCH(...)
+#endif
+
+// Set during static initialization, as close to process start as the program can see.
+DEV(static const auto launched = std::chrono::steady_clock::now();)
+
+BENCH(static std::optional<app::Bench> bench;)
+// Opened by --record; takes every key and text event the loop handles.
+static app::TraceRecorder trace;
+
+#ifdef _BENCH_
+// Every allocation on every thread is counted, so the report can tell which frames allocate.
+void *operator new(size_t size) {
+    app::Bench::allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+
+// No display and no GPU: the offscreen driver if SDL has it, otherwise the dummy one, with the
+// software renderer either way so frame times do not depend on a graphics driver.
+constexpr Uint32 RENDERER_FLAGS = SDL_RENDERER_SOFTWARE;
+
+bool initSDL() {
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+    for (const char *driver : {"offscreen", "dummy"}) {
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, driver);
+        if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_TIMER) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+#else
+constexpr Uint32 RENDERER_FLAGS = SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC;
+
+bool initSDL() { return SDL_Init(SDL_INIT_EVERYTHING) == 0; }
+#endif
+
+// Records logged before a fatal error are written out before the process goes.
+[[noreturn]] void fail() {
+    core::Logger::get().flush();
+    exit(EXIT_FAILURE);
+}
+
 enum class VimMode { NORMAL, INSERT, VISUAL, REPLACE };
 
 typedef struct {
@@ -26,259 +95,635 @@ typedef struct {
     std::string macro_buffer;
     std::string command_buffer;
     std::string keystroke_buffer;
+    size_t count = 0;
+    size_t visual_anchor = 0;
+    std::string last_change;
+    size_t last_change_count = 1;
+    char recording = 0;
+    bool replaying = false;
+    size_t last_key_offset = 0;
+    std::unordered_map<char, std::string> registers;
+    app::KeySequence keys;
+    std::string typed_text;
 } Vim;
 
-void eventLoop(app::AppState &appState, platform::ConfigWatcher &watcher, config::EditorConfig &state,
-               buffer::EditorBuffer &buffer) {
+// Insert-mode text is held until a key resolves to an action or the frame ends, so a burst of text
+// input becomes one insertion. Actions flush first, which keeps ordering and undo grouping intact.
+bool flushTypedText(Vim &vim, buffer::EditorBuffer &buffer) {
+    if (vim.typed_text.empty()) {
+        return false;
+    }
+    buffer.insertText(vim.typed_text);
+    vim.typed_text.clear();
+    return true;
+}
+
+// Macros hold the raw key and text input events so replay runs the same handlers as live typing
+void recordEvent(Vim &vim, const SDL_Event &event) {
+    if (event.type == SDL_KEYDOWN) {
+        vim.last_key_offset = vim.keystroke_buffer.size();
+    }
+    app::encodeEvent(vim.keystroke_buffer, event);
+}
+
+void stopRecording(Vim &vim) {
+    // Drop the key press of the closing q, which was recorded before its text input arrived
+    std::string &macro = vim.keystroke_buffer;
+    if (vim.last_key_offset < macro.size()) {
+        SDL_Event last;
+        app::decodeEvent(macro, vim.last_key_offset, last);
+        if (last.type == SDL_KEYDOWN && last.key.keysym.sym == SDLK_q) {
+            macro.resize(vim.last_key_offset);
+        }
+    }
+    vim.registers[vim.recording] = std::move(macro);
+    vim.keystroke_buffer.clear();
+    vim.recording = 0;
+}
+
+size_t takeCount(Vim &vim) {
+    size_t count = std::max<size_t>(vim.count, 1);
+    vim.count = 0;
+    return count;
+}
+
+bool handleCount(Vim &vim, const std::string &text) {
+    if (text.size() != 1 || !std::isdigit(static_cast<unsigned char>(text[0])) || (text == "0" && vim.count == 0)) {
+        return false;
+    }
+    vim.count = vim.count * 10 + (text[0] - '0');
+    return true;
+}
+
+bool handleMotion(Vim &vim, buffer::EditorBuffer &buffer, const std::string &text) {
+    if (text == "w" || text == "W") {
+        buffer.moveWordForward(takeCount(vim), text == "W");
+    } else if (text == "b" || text == "B") {
+        buffer.moveWordBackward(takeCount(vim), text == "B");
+    } else if (text == "e" || text == "E") {
+        buffer.moveWordEnd(takeCount(vim), text == "E");
+    } else if (text == "%") {
+        vim.count = 0;
+        return buffer.jumpToMatchingBracket();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// A count is handed to the buffer whole, so 10000dd is one erase and one undo record
+bool applyChange(Vim &vim, buffer::EditorBuffer &buffer, const std::string &change, size_t count) {
+    if (change != "dd" && change != "x") {
+        return false;
+    }
+    buffer.commit();
+    if (change == "dd") {
+        buffer.deleteLines(count);
+    } else {
+        buffer.deleteChars(count);
+    }
+    vim.last_change = change;
+    vim.last_change_count = count;
+    return true;
+}
+
+bool handleOperator(Vim &vim, buffer::EditorBuffer &buffer, const std::string &text) {
+    std::string change = vim.command_buffer + text;
+    vim.command_buffer.clear();
+    size_t count = takeCount(vim);
+    return applyChange(vim, buffer, change, count);
+}
+
+bool handleTextObject(Vim &vim, buffer::EditorBuffer &buffer, const std::string &text) {
+    bool around = vim.command_buffer == "a";
+    vim.command_buffer.clear();
+    std::pair<size_t, size_t> range;
+    if (text == "w" || text == "W") {
+        range = buffer.getWordObject(around, text == "W");
+    } else if (text == "p" && !around) {
+        range = buffer.getParagraphObject();
+    } else {
+        return false;
+    }
+    if (range.second > range.first) {
+        vim.visual_anchor = range.first;
+        buffer.setCursor(range.second - 1);
+    }
+    return true;
+}
+
+bool handleEvent(const SDL_Event &event, app::AppState &appState, config::EditorConfig &state,
+                 buffer::BufferManager &buffers, Vim &vim, const app::Keymap &keymap);
+
+// Replays a register without touching the SDL queue or renderer, as one undo step
+void replayMacro(app::AppState &appState, config::EditorConfig &state, buffer::BufferManager &buffers, Vim &vim,
+                 const app::Keymap &keymap, const std::string &macro, size_t count) {
+    auto &buffer = buffers.active();
+    SDL_Event event;
+    vim.replaying = true;
+    buffer.beginTransaction();
+    for (size_t i = 0; i < count; i++) {
+        for (size_t offset = 0; offset < macro.size();) {
+            offset = app::decodeEvent(macro, offset, event);
+            handleEvent(event, appState, state, buffers, vim, keymap);
+        }
+    }
+    flushTypedText(vim, buffer);
+    buffer.endTransaction();
+    vim.replaying = false;
+}
+
+bool handleMacroCommand(app::AppState &appState, config::EditorConfig &state, buffer::BufferManager &buffers, Vim &vim,
+                        const app::Keymap &keymap, const std::string &text) {
+    std::string command = std::move(vim.command_buffer);
+    vim.command_buffer.clear();
+    if (text.size() != 1 || (!std::isalnum(static_cast<unsigned char>(text[0])) && text != "@")) {
+        vim.count = 0;
+        return false;
+    }
+    char reg = text[0];
+    if (command == "q") {
+        vim.recording = reg;
+        vim.keystroke_buffer.clear();
+        return false;
+    }
+    if (vim.replaying) {
+        vim.count = 0;
+        return false;
+    }
+    size_t count = takeCount(vim);
+    if (reg != '@') {
+        vim.macro_buffer = vim.registers[reg];
+    }
+    replayMacro(appState, state, buffers, vim, keymap, vim.macro_buffer, count);
+    return true;
+}
+
+app::InputMode inputMode(const config::EditorConfig &state, const Vim &vim) {
+    if (!state.input.vim_mode) {
+        return app::InputMode::EDIT;
+    }
+    switch (vim.mode) {
+    case VimMode::NORMAL:
+        return app::InputMode::NORMAL;
+    case VimMode::INSERT:
+        return app::InputMode::INSERT;
+    case VimMode::VISUAL:
+        return app::InputMode::VISUAL;
+    case VimMode::REPLACE:
+        return app::InputMode::REPLACE;
+    }
+    return app::InputMode::EDIT;
+}
+
+bool runAction(app::Action action, buffer::BufferManager &buffers, Vim &vim) {
+    auto &buffer = buffers.active();
+    switch (action) {
+    case app::Action::SAVE:
+        // Nothing on screen changes.
+        buffers.save(buffers.getActiveId());
+        return false;
+    case app::Action::NEXT_BUFFER:
+    case app::Action::PREVIOUS_BUFFER:
+        if (vim.replaying) {
+            return false;
+        }
+        if (action == app::Action::NEXT_BUFFER) {
+            buffers.focusNext();
+        } else {
+            buffers.focusPrevious();
+        }
+        return true;
+    case app::Action::UNDO:
+    case app::Action::REDO:
+        // A replay is one transaction; undoing inside it would pop the record it started from.
+        if (vim.replaying) {
+            return false;
+        }
+        if (action == app::Action::UNDO) {
+            buffer.undo();
+        } else {
+            buffer.redo();
+        }
+        return true;
+    case app::Action::MOVE_LEFT:
+        buffer.moveLeft(takeCount(vim));
+        return true;
+    case app::Action::MOVE_RIGHT:
+        buffer.moveRight(takeCount(vim));
+        return true;
+    case app::Action::MOVE_UP:
+        buffer.moveUp(takeCount(vim));
+        return true;
+    case app::Action::MOVE_DOWN:
+        buffer.moveDown(takeCount(vim));
+        return true;
+    case app::Action::GOTO_FIRST_LINE:
+        buffer.gotoLine(takeCount(vim) - 1);
+        return true;
+    case app::Action::GOTO_LAST_LINE:
+        buffer.gotoLine(vim.count > 0 ? takeCount(vim) - 1 : buffer.getLineCount() - 1);
+        return true;
+    case app::Action::ENTER_NORMAL:
+        vim.mode = VimMode::NORMAL;
+        vim.command_buffer.clear();
+        return true;
+    case app::Action::COMMIT:
+        buffer.commit();
+        return true;
+    case app::Action::NEWLINE:
+        buffer.commit();
+        buffer.insertText("\n");
+        return true;
+    case app::Action::DELETE_BACKWARD:
+        if (buffer.getCursor() == 0) {
+            return false;
+        }
+        buffer.commit();
+        buffer.backspace(1);
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool handleEvent(const SDL_Event &event, app::AppState &appState, config::EditorConfig &state,
+                 buffer::BufferManager &buffers, Vim &vim, const app::Keymap &keymap) {
+    bool dirty = false;
+    auto &buffer = buffers.active();
+    if (event.type == SDL_WINDOWEVENT) {
+        if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED || event.window.event == SDL_WINDOWEVENT_RESIZED) {
+            SDL_GetWindowSize(appState.window, &appState.window_width, &appState.window_height);
+        }
+    } else if (event.type == SDL_TEXTINPUT) {
+        std::string text = event.text.text;
+        if (vim.mode == VimMode::INSERT) {
+            vim.typed_text += text;
+            dirty = true;
+        } else if (vim.mode == VimMode::NORMAL) {
+            if (vim.command_buffer == "d") {
+                return handleOperator(vim, buffer, text);
+            } else if (!vim.command_buffer.empty()) {
+                return handleMacroCommand(appState, state, buffers, vim, keymap, text);
+            }
+            if (handleCount(vim, text)) {
+                return false;
+            }
+            if (handleMotion(vim, buffer, text)) {
+                dirty = true;
+            } else if (text == "i") {
+                vim.mode = VimMode::INSERT;
+                dirty = true;
+            } else if (text == "I") {
+                vim.mode = VimMode::INSERT;
+                buffer.setCursorToBeginningColumn();
+                dirty = true;
+            } else if (text == "a") {
+                vim.mode = VimMode::INSERT;
+                buffer.setCursor(buffer.getCursor() + 1);
+                dirty = true;
+            } else if (text == "A") {
+                vim.mode = VimMode::INSERT;
+                buffer.setCursorToEndingColumn();
+                dirty = true;
+            } else if (text == "v") {
+                vim.mode = VimMode::VISUAL;
+                vim.visual_anchor = buffer.getCursor();
+                dirty = true;
+            } else if (text == "R") {
+                vim.mode = VimMode::REPLACE;
+                buffer.commit();
+                dirty = true;
+            } else if (text == "x") {
+                dirty = applyChange(vim, buffer, text, takeCount(vim));
+            } else if (text == ".") {
+                size_t count = vim.count > 0 ? takeCount(vim) : vim.last_change_count;
+                dirty = applyChange(vim, buffer, vim.last_change, count);
+            } else if (text == "d") {
+                vim.command_buffer = text;
+            } else if (text == "q" && vim.recording) {
+                stopRecording(vim);
+            } else if ((text == "q" && !vim.replaying) || text == "@") {
+                vim.command_buffer = text;
+            }
+        } else if (vim.mode == VimMode::VISUAL) {
+            if (!vim.command_buffer.empty()) {
+                if (handleTextObject(vim, buffer, text)) {
+                    dirty = true;
+                }
+            } else if (text == "i" || text == "a") {
+                vim.command_buffer = text;
+            } else if (text == "d" || text == "x") {
+                size_t start = std::min(vim.visual_anchor, buffer.getCursor());
+                size_t end = std::max(vim.visual_anchor, buffer.getCursor()) + 1;
+                buffer.commit();
+                buffer.eraseRange(start, end);
+                buffer.setCursor(start);
+                vim.mode = VimMode::NORMAL;
+                vim.count = 0;
+                dirty = true;
+            } else if (!handleCount(vim, text) && handleMotion(vim, buffer, text)) {
+                dirty = true;
+            }
+        } else if (vim.mode == VimMode::REPLACE) {
+            buffer.overwrite(text);
+            dirty = true;
+        }
+    } else if (event.type == SDL_KEYDOWN) {
+        // Operators and registers are completed by the text input event that follows the key
+        if (state.input.vim_mode && vim.mode == VimMode::NORMAL && !vim.command_buffer.empty()) {
+            if (event.key.keysym.sym == SDLK_ESCAPE) {
+                vim.command_buffer.clear();
+                vim.count = 0;
+            }
+            return false;
+        }
+        app::Action action = keymap.dispatch(vim.keys, inputMode(state, vim), event.key.keysym.mod, event.key.keysym.sym);
+        if (action != app::Action::NONE && action != app::Action::PENDING) {
+            flushTypedText(vim, buffer);
+        }
+        dirty = runAction(action, buffers, vim);
+    }
+    return dirty;
+}
+
+void eventLoop(app::AppState &appState, app::FrameScheduler &scheduler, platform::ConfigWatcher &watcher,
+               config::EditorConfig &state, buffer::BufferManager &buffers, std::shared_ptr<const app::Keymap> &keymap) {
     auto running = true;
     SDL_Event event;
 
-    text::FontManager fonts;
-    fonts.updateFont(state.font.family, state.font.style, state.font.size);
+    text::FontManager fonts([&scheduler]() { scheduler.wake(); });
+    // ui_scale is a percentage of the font size.
+    auto fontSize = [&state]() { return std::max(1, state.font.size * state.ui.ui_scale / 100); };
+    fonts.updateFont(state.font.family, state.font.style, fontSize());
+    text::FontFallback fallback([&scheduler]() { scheduler.wake(); });
+    std::vector<Uint32> resolved;
+    fallback.reset(fonts.getFont(), fontSize());
+    ui::AtlasCache atlases(text::FontManager::MAX_FACES);
+    ui::GlyphAtlas *atlas = &atlases.get(appState.renderer, fonts.getFont(), fonts.getGeneration(), &fallback);
+    // Metrics only on this thread; lines are laid out by the worker.
+    text::Typesetter typesetter(1);
+    ui::LayoutWorker layout([&scheduler]() { scheduler.wake(); });
+    ui::Viewport viewport;
+    const buffer::EditorBuffer *followed = nullptr;
+    size_t followed_cursor = SIZE_MAX;
+
+    ui::Canvas canvas;
+    ui::Damage damage;
+    damage.addAll();
+    ui::Overlays overlays = {};
+    size_t drawn_top = 0;
+    int drawn_offset = 0;
 
     bool dirty = true;
+    uint64_t sequence = 0;
+    DEV(app::LatencyTracker latency;)
+    DEV(auto dumped = std::chrono::steady_clock::now();)
 
     auto vim = Vim{VimMode::NORMAL};
 
+    // The first frame is drawn without waiting for input.
+    scheduler.requestFrameAt(0);
     while (running) {
-        SDL_WaitEventTimeout(NULL, 250);
+        BENCH(bench->next(buffers.active(), scheduler);)
+        // Every pass below either drew a frame or found nothing damaged, so sleep until woken.
+        scheduler.wait();
         while (SDL_PollEvent(&event) != 0) {
+            DEV(latency.delivered(event);)
             if (event.type == SDL_QUIT) {
                 running = false;
-            } else if (event.type == SDL_QUIT) {
-            } else if (event.type == SDL_WINDOWEVENT) {
-                if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED || event.window.event == SDL_WINDOWEVENT_RESIZED) {
-                    SDL_GetWindowSize(appState.window, &appState.window_width, &appState.window_height);
-                }
-            } else if (event.type == SDL_TEXTINPUT) {
-                std::string text = event.text.text;
-                if (vim.mode == VimMode::INSERT) {
-                    std::cout << text << std::endl;
-                    buffer.insertText(text);
-                    dirty = true;
-                } else if (vim.mode == VimMode::NORMAL) {
-                    if (text == "i") {
-                        vim.mode = VimMode::INSERT;
-                        dirty = true;
-                    } else if (text == "I") {
-                        vim.mode = VimMode::INSERT;
-                        buffer.setCursorToBeginningColumn();
-                        dirty = true;
-                    } else if (text == "a") {
-                        vim.mode = VimMode::INSERT;
-                        buffer.setCursor(buffer.getCursor() + 1);
-                        dirty = true;
-                    } else if (text == "A") {
-                        vim.mode = VimMode::INSERT;
-                        buffer.setCursorToEndingColumn();
-                        dirty = true;
-                    } else if (text == "v") {
-                        vim.mode = VimMode::VISUAL;
-                        dirty = true;
-                    } else if (text == "R") {
-                        vim.mode = VimMode::REPLACE;
-                        dirty = true;
-                    }
-                }
-            } else if (event.type == SDL_KEYDOWN) {
-                if (state.input.vim_mode) {
-                    if (vim.mode == VimMode::NORMAL) {
-                        if (event.key.keysym.sym == SDLK_u) {
-                            buffer.undo();
-                            dirty = true;
-                        }
-                        if (event.key.keysym.mod & KMOD_CTRL && event.key.keysym.sym == SDLK_r) {
-                            buffer.redo();
-                            dirty = true;
-                        }
-                        if (event.key.keysym.sym == SDLK_h) {
-                            buffer.moveLeft();
-                            dirty = true;
-                        }
-                        if (event.key.keysym.sym == SDLK_l) {
-                            buffer.moveRight();
-                            dirty = true;
-                        }
-                        if (event.key.keysym.sym == SDLK_k) {
-                            buffer.moveUp();
-                            dirty = true;
-                        }
-                        if (event.key.keysym.sym == SDLK_j) {
-                            buffer.moveDown();
-                            dirty = true;
-                        }
-                        if (event.key.keysym.sym == SDLK_RETURN || event.key.keysym.sym == SDLK_KP_ENTER) {
-                            buffer.moveDown();
-                            dirty = true;
-                        }
-                        if (event.key.keysym.sym == SDLK_BACKSPACE) {
-                            buffer.moveLeft();
-                            dirty = true;
-                        }
-                    } else if (vim.mode == VimMode::INSERT) {
-                        if (event.key.keysym.sym == SDLK_LEFT) {
-                            buffer.moveLeft();
-                            dirty = true;
-                        }
-                        if (event.key.keysym.sym == SDLK_RIGHT) {
-                            buffer.moveRight();
-                            dirty = true;
-                        }
-                        if (event.key.keysym.sym == SDLK_UP) {
-                            buffer.moveUp();
-                            dirty = true;
-                        }
-                        if (event.key.keysym.sym == SDLK_DOWN) {
-                            buffer.moveDown();
-                            dirty = true;
-                        }
-                        if (event.key.keysym.sym == SDLK_ESCAPE) {
-                            vim.mode = VimMode::NORMAL;
-                            dirty = true;
-                        }
-                        if (event.key.keysym.sym == SDLK_SPACE) {
-                            buffer.commit();
-                            dirty = true;
-                        }
-                        if (event.key.keysym.sym == SDLK_RETURN || event.key.keysym.sym == SDLK_KP_ENTER) {
-                            buffer.commit();
-                            buffer.insertText("\n");
-                            dirty = true;
-                        }
-                        if (event.key.keysym.sym == SDLK_BACKSPACE && buffer.getCursor() > 0) {
-                            buffer.commit();
-                            buffer.backspace(1);
-                            dirty = true;
-                        }
-                    } else if (vim.mode == VimMode::VISUAL) {
-                        if (event.key.keysym.sym == SDLK_ESCAPE) {
-                            vim.mode = VimMode::NORMAL;
-                            dirty = true;
-                        }
-                    } else if (vim.mode == VimMode::REPLACE) {
-                        if (event.key.keysym.sym == SDLK_ESCAPE) {
-                            vim.mode = VimMode::NORMAL;
-                            dirty = true;
-                        }
-                    }
-                } else {
-                    if (event.key.keysym.sym == SDLK_LEFT) {
-                        buffer.moveLeft();
-                        dirty = true;
-                    }
-                    if (event.key.keysym.sym == SDLK_RIGHT) {
-                        buffer.moveRight();
-                        dirty = true;
-                    }
-                    if (event.key.keysym.sym == SDLK_UP) {
-                        buffer.moveUp();
-                        dirty = true;
-                    }
-                    if (event.key.keysym.sym == SDLK_DOWN) {
-                        buffer.moveDown();
-                        dirty = true;
-                    }
-                    if (event.key.keysym.mod & (KMOD_CTRL | KMOD_GUI) && event.key.keysym.sym == SDLK_z) {
-                        buffer.undo();
-                        dirty = true;
-                    }
-                    if (event.key.keysym.mod & (KMOD_CTRL | KMOD_GUI) && event.key.keysym.sym == SDLK_r) {
-                        buffer.redo();
-                        dirty = true;
-                    }
-                    if (event.key.keysym.sym == SDLK_SPACE || event.key.keysym.sym == SDLK_RETURN ||
-                        event.key.keysym.sym == SDLK_KP_ENTER) {
-                        buffer.commit();
-                        buffer.insertText("\n");
-                        dirty = true;
-                    }
-                    if (event.key.keysym.sym == SDLK_BACKSPACE && buffer.getCursor() > 0) {
-                        buffer.commit();
-                        buffer.backspace(1);
-                        dirty = true;
-                    }
-                }
+                continue;
+            }
+            if (event.type == scheduler.getWakeEvent()) {
+                scheduler.onWake();
+                continue;
+            }
+            if (event.type == SDL_WINDOWEVENT) {
+                damage.addAll();
+            } else if (event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET) {
+                canvas.invalidate();
+                damage.addAll();
+            }
+            if (event.type == SDL_MOUSEWHEEL) {
+                int line_h = typesetter.getLineHeight();
+                viewport.scrollBy(-event.wheel.y * config::scroll::WHEEL_LINES * line_h, line_h,
+                                  buffers.active().getVisualRowCount());
+                dirty = true;
+                continue;
+            }
+            if (trace.isOpen()) {
+                trace.record(event);
+            }
+            if (vim.recording) {
+                recordEvent(vim, event);
+            }
+            if (handleEvent(event, appState, state, buffers, vim, *keymap)) {
+                dirty = true;
             }
         }
+        flushTypedText(vim, buffers.active());
+        DEV(latency.applied();)
 
         if (dirty) {
             dirty = false;
-            std::cout << "| Cursor Pos: " << buffer.getCursor() << " | Text Length: " << buffer.getTotalLength() << " | Mode: "
-                      << (vim.mode == VimMode::NORMAL   ? "Normal"
-                          : vim.mode == VimMode::INSERT ? "Insert"
-                          : vim.mode == VimMode::VISUAL ? "Visual"
-                                                        : "Replace")
-                      << " |\n\n";
-            std::string t = buffer.getText();
-            std::cout << t.substr(0, buffer.getCursor());
-            std::cout << "|";
-            std::cout << t.substr(buffer.getCursor(), t.length() - buffer.getCursor()) << std::endl;
+            BLIP_LOG(DEBUG, APP, "cursor ", buffers.active().getCursor(), " length ", buffers.active().getTotalLength(),
+                     " mode ",
+                     vim.mode == VimMode::NORMAL   ? "normal"
+                     : vim.mode == VimMode::INSERT ? "insert"
+                     : vim.mode == VimMode::VISUAL ? "visual"
+                                                   : "replace");
         }
 
-        watcher.check();
+        if (watcher.check()) {
+            damage.addAll();
+        }
+        buffers.active().setTabWidth(state.preference.tab_width);
 
-        if (fonts.updateFont(state.font.family, state.font.style, state.font.size)) {
+        if (fonts.updateFont(state.font.family, state.font.style, fontSize())) {
+            fallback.reset(fonts.getFont(), fontSize());
+            atlas = &atlases.get(appState.renderer, fonts.getFont(), fonts.getGeneration(), &fallback);
             dirty = true;
         }
+        // Glyphs drawn with the primary font while fontconfig was still looking are redrawn.
+        if (fallback.poll(resolved)) {
+            atlases.forget(resolved);
+            damage.addAll();
+        }
+
+        if (typesetter.configure({fonts.getGeneration(), atlas->getCellWidth(), atlas->getFontHeight(), atlas->getLineSkip()},
+                                 state.preference.tab_width, state.font.line_height)) {
+            damage.addAll();
+        }
+
+        // Soft wrap follows the window width. Only the lines on screen and around the cursor are
+        // measured now, the rest a slice per frame; the view holds on to the line at its top while
+        // rows above it are measured, so neither a resize nor the sweep moves the text.
+        auto &active = buffers.active();
+        int cell_w = atlas->getCellWidth();
+        size_t wrap_width = state.preference.word_wrap && cell_w > 0
+                                ? (size_t)std::max(1, (appState.window_width - config::positions::x::TEXT) / cell_w)
+                                : 0;
+        size_t visible = viewport.getVisibleRows(appState.window_height, typesetter.getLineHeight());
+        bool cursor_moved = &active != followed || active.getCursor() != followed_cursor;
+        auto [top_line, top_sub_row] = active.locateVisualRow(viewport.getTopLine());
+        active.setWrapWidth(wrap_width);
+        if (active.refineWrap(config::wrap::MEASURE_BUDGET)) {
+            scheduler.requestFrameAt(SDL_GetTicks64());
+        }
+        if (cursor_moved) {
+            active.measureWrap(active.getLineFromIndex(active.getCursor()), visible, visible);
+        }
+        active.measureWrap(top_line, 0, top_sub_row + visible);
+        size_t top_rows = active.getVisualRow(top_line + 1) - active.getVisualRow(top_line);
+        // A new number for the same top row repaints everything below, like a scroll would.
+        viewport.setTopLine(active.getVisualRow(top_line) + std::min(top_sub_row, top_rows - 1));
 
-        ui::drawBackground(appState, state);
-        ui::drawEditor(appState, state, fonts);
+        // The view follows the cursor only when it moves, so wheel scrolling can leave it off screen.
+        if (&active != followed) {
+            damage.addAll();
+        }
+        if (cursor_moved) {
+            followed = &active;
+            followed_cursor = active.getCursor();
+            viewport.reveal(active.getVisualRowOf(active.getCursor()), appState.window_height, typesetter.getLineHeight());
+        }
+        // Scrolling repaints everything; edits and cursor motion repaint only the rows they touched.
+        if (viewport.getTopLine() != drawn_top || viewport.getPixelOffset() != drawn_offset) {
+            drawn_top = viewport.getTopLine();
+            drawn_offset = viewport.getPixelOffset();
+            damage.addAll();
+        }
+        if (auto rows = active.takeDamagedRows()) {
+            damage.addRows(active.getVisualRow(rows->first),
+                           rows->second == SIZE_MAX ? SIZE_MAX : active.getVisualRow(rows->second));
+        }
+        ui::Overlays current = ui::findOverlays(appState, state, typesetter, viewport, active);
+        ui::damageOverlays(damage, overlays, current);
+        overlays = current;
 
-        SDL_RenderPresent(appState.renderer);
+        // Input is applied above without waiting on layout; the frame is painted from whichever
+        // draw list the worker finished last and the worker wakes the loop when the next is ready.
+        if (!damage.isEmpty()) {
+            auto [first_line, sub_row] = active.locateVisualRow(viewport.getTopLine());
+            layout.submit({++sequence, active.snapshot(), viewport.getTopLine(),
+                           viewport.getVisibleRows(appState.window_height, typesetter.getLineHeight()), first_line,
+                           sub_row, active.getCarriedIndent(first_line), wrap_width, viewport.getPixelOffset(),
+                           {fonts.getGeneration(), atlas->getCellWidth(), atlas->getFontHeight(), atlas->getLineSkip()},
+                           state.preference.tab_width, state.font.line_height, state.font.ligatures, overlays,
+                           damage});
+            damage.clear();
+            BENCH(bench->submitted(sequence);)
+            DEV(latency.submitted(sequence);)
+        }
+        if (auto list = layout.take()) {
+            bool full = !canvas.begin(appState);
+            ui::drawFrame(appState, state, *atlas, *list, full);
+            canvas.compose(appState);
+            DEV(ui::drawStatsOverlay(appState, state, *atlas, latency.summarize());)
+            DEV(auto drawn = std::chrono::steady_clock::now();)
+            canvas.present(appState);
+            BENCH(bench->presented(list->sequence);)
+            DEV(latency.presented(list->sequence, list->laid_out, drawn);)
+            DEV({
+                static bool reported = false;
+                if (!reported) {
+                    reported = true;
+                    auto elapsed = std::chrono::steady_clock::now() - launched;
+                    BLIP_LOG(INFO, APP, "First frame after ",
+                             std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() / 1000.0, " ms");
+                }
+            })
+        }
+        BENCH(bench->endPass();)
+        DEV({
+            latency.endPass();
+            auto now = std::chrono::steady_clock::now();
+            if (now - dumped >= std::chrono::seconds(config::latency::DUMP_SECONDS)) {
+                dumped = now;
+                latency.dump();
+            }
+        })
     }
 }
 
 // TODO: MIGHT WANT TO DISPLAY ERRORS USING A NEW WINDOW SO THE USER STAYS INFORMED
 int main(int argc, char *argv[]) {
     app::AppState appState;
-    if (SDL_Init(SDL_INIT_EVERYTHING) < 0) {
+#ifdef _BENCH_
+    std::string benchfile;
+    bench = app::Bench::fromArgs(argc, argv, benchfile);
+    if (!bench) {
+        std::cerr << "Usage: " << argv[0] << " <scroll|edit> <file size, e.g. 1K or 10M> [steps]\n"
+                  << "       " << argv[0] << " replay <trace> <file or file size>" << std::endl;
+        fail();
+    }
+#endif
+    if (!initSDL()) {
         std::cerr << "SDL Init Error " << SDL_GetError() << std::endl;
-        exit(EXIT_FAILURE);
+        fail();
     }
 
     if (TTF_Init() < 0) {
         std::cerr << "TTF Init Error " << TTF_GetError() << std::endl;
-        exit(EXIT_FAILURE);
+        fail();
     }
 
     appState.window = SDL_CreateWindow("Blip", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 800, 600,
                                        SDL_WINDOW_RESIZABLE | SDL_WINDOW_SHOWN);
     if (appState.window == NULL) {
         std::cerr << SDL_GetError() << std::endl;
-        exit(EXIT_FAILURE);
+        fail();
     }
 
     SDL_RaiseWindow(appState.window); // Focus Window
 
     SDL_GetWindowSize(appState.window, &appState.window_width, &appState.window_height);
-    appState.renderer = SDL_CreateRenderer(appState.window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    appState.renderer = SDL_CreateRenderer(appState.window, -1, RENDERER_FLAGS);
     if (appState.renderer == NULL) {
         std::cerr << SDL_GetError() << std::endl;
-        exit(EXIT_FAILURE);
+        fail();
     }
 
     config::EditorConfig state;
     config::setDefaultConifg(state);
+    // The watcher wakes the scheduler from its thread, so it is declared after it and destroyed first.
+    app::FrameScheduler scheduler;
+    if (!scheduler.init()) {
+        fail();
+    }
     platform::ConfigWatcher watcher;
 
     // TODO: Calculate filepath using system file lookup
     std::string filepath = "config.ini";
     config::loadConfig(filepath, state);
     DEV(core::printState(state));
-    watcher.start(filepath, [&state, filepath]() {
+    // The keymap is recompiled whole and swapped in, so a half-applied config is never dispatched
+    auto keymap = app::Keymap::compile(state);
+    watcher.start(filepath, [&state, &keymap, filepath]() {
         config::loadConfig(filepath, state);
+        keymap = app::Keymap::compile(state);
         DEV(core::printState(state));
-    });
+    }, [&scheduler]() { scheduler.wake(); });
 
-    std::string original_content = "";
-    if (argc == 2) {
-        platform::readFile(argv[1], original_content);
+    buffer::BufferManager buffers;
+#ifdef _BENCH_
+    buffers.open(benchfile);
+#else
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            trace.open(argv[++i]);
+            continue;
+        }
+        buffers.open(argv[i]);
     }
-    buffer::EditorBuffer buffer(original_content);
+#endif
+    buffers.focus(0);
 
     SDL_StartTextInput();
-    eventLoop(appState, watcher, state, buffer);
+    eventLoop(appState, scheduler, watcher, state, buffers, keymap);
     SDL_StopTextInput();
+    BENCH(bench->report(std::cout);)
+    watcher.stop();
 
     SDL_DestroyRenderer(appState.renderer);
     SDL_DestroyWindow(appState.window);
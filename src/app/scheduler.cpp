@@ -0,0 +1,51 @@
+#include <blip/app/scheduler.hpp>
+#include <algorithm>
+#include <iostream>
+
+namespace app {
+
+bool FrameScheduler::init() {
+    wake_event = SDL_RegisterEvents(1);
+    if (wake_event == (Uint32)-1) {
+        std::cerr << "Unable to register wake event! Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+Uint32 FrameScheduler::getWakeEvent() const { return wake_event; }
+
+void FrameScheduler::wake() {
+    if (wake_event == (Uint32)-1 || wake_pending.exchange(true)) {
+        return;
+    }
+    SDL_Event event;
+    SDL_zero(event);
+    event.type = wake_event;
+    if (SDL_PushEvent(&event) <= 0) {
+        wake_pending = false;
+    }
+}
+
+void FrameScheduler::onWake() { wake_pending = false; }
+
+void FrameScheduler::requestFrameAt(Uint64 ticks) { deadline = std::min(deadline, ticks); }
+
+bool FrameScheduler::wait() {
+    if (deadline == UINT64_MAX) {
+        SDL_WaitEvent(NULL);
+        return false;
+    }
+    Uint64 now = SDL_GetTicks64();
+    if (now >= deadline || SDL_WaitEventTimeout(NULL, (int)std::min<Uint64>(deadline - now, INT32_MAX)) == 0) {
+        deadline = UINT64_MAX;
+        return true;
+    }
+    // Woken by an event: the deadline stays until it passes.
+    if (SDL_GetTicks64() >= deadline) {
+        deadline = UINT64_MAX;
+        return true;
+    }
+    return false;
+}
+}
@@ -0,0 +1,81 @@
+#include <blip/app/trace.hpp>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+namespace app {
+namespace {
+constexpr const char MAGIC[] = "BLIPTRACE1\n";
+constexpr size_t MAGIC_SIZE = sizeof(MAGIC) - 1;
+constexpr size_t KEY_SIZE = 1 + sizeof(SDL_Keycode) + sizeof(Uint16);
+}
+
+void encodeEvent(std::string &out, const SDL_Event &event) {
+    if (event.type == SDL_TEXTINPUT) {
+        size_t len = std::strlen(event.text.text);
+        out.push_back('T');
+        out.push_back(static_cast<char>(len));
+        out.append(event.text.text, len);
+    } else if (event.type == SDL_KEYDOWN) {
+        out.push_back('K');
+        out.append(reinterpret_cast<const char *>(&event.key.keysym.sym), sizeof(SDL_Keycode));
+        out.append(reinterpret_cast<const char *>(&event.key.keysym.mod), sizeof(Uint16));
+    }
+}
+
+size_t decodeEvent(const std::string &data, size_t offset, SDL_Event &event) {
+    event = SDL_Event{};
+    if (data[offset] == 'T') {
+        size_t len = static_cast<unsigned char>(data[offset + 1]);
+        event.type = SDL_TEXTINPUT;
+        std::memcpy(event.text.text, data.data() + offset + 2, len);
+        return offset + 2 + len;
+    }
+    event.type = SDL_KEYDOWN;
+    std::memcpy(&event.key.keysym.sym, data.data() + offset + 1, sizeof(SDL_Keycode));
+    std::memcpy(&event.key.keysym.mod, data.data() + offset + 1 + sizeof(SDL_Keycode), sizeof(Uint16));
+    return offset + KEY_SIZE;
+}
+
+bool TraceRecorder::open(const std::string &path) {
+    out.open(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Unable to record trace to " << path << std::endl;
+        return false;
+    }
+    out.write(MAGIC, MAGIC_SIZE);
+    return true;
+}
+
+bool TraceRecorder::isOpen() const { return out.is_open(); }
+
+// Left to the stream's buffer; the file is complete once the recorder is destroyed.
+void TraceRecorder::record(const SDL_Event &event) {
+    encoded.clear();
+    encodeEvent(encoded, event);
+    out.write(encoded.data(), (std::streamsize)encoded.size());
+}
+
+std::optional<std::vector<SDL_Event>> loadTrace(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    std::string data(std::istreambuf_iterator<char>(in), {});
+    if (data.compare(0, MAGIC_SIZE, MAGIC) != 0) {
+        return std::nullopt;
+    }
+
+    std::vector<SDL_Event> events;
+    SDL_Event event;
+    for (size_t offset = MAGIC_SIZE; offset < data.size();) {
+        size_t remaining = data.size() - offset;
+        bool whole = data[offset] == 'T' ? remaining >= 2 && (unsigned char)data[offset + 1] < sizeof(event.text.text) &&
+                                               remaining >= 2 + (size_t)(unsigned char)data[offset + 1]
+                                         : data[offset] == 'K' && remaining >= KEY_SIZE;
+        if (!whole) {
+            return std::nullopt;
+        }
+        offset = decodeEvent(data, offset, event);
+        events.push_back(event);
+    }
+    return events;
+}
+}
@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <blip/buffer/brackets.hpp>
+#include <blip/buffer/iterator.hpp>
+
+namespace buffer {
+
+namespace {
+typedef struct {
+    int8_t kind;
+    int8_t value;
+} BracketCode;
+
+constexpr std::array<BracketCode, 256> makeBracketCodes() {
+    std::array<BracketCode, 256> codes{};
+    for (auto &code : codes) {
+        code = {-1, 0};
+    }
+    codes['('] = {0, 1};
+    codes[')'] = {0, -1};
+    codes['['] = {1, 1};
+    codes[']'] = {1, -1};
+    codes['{'] = {2, 1};
+    codes['}'] = {2, -1};
+    return codes;
+}
+
+constexpr const std::array<BracketCode, 256> BRACKET_CODES = makeBracketCodes();
+constexpr const size_t NOT_FOUND = static_cast<size_t>(-1);
+
+const BracketCode &codeOf(char c) { return BRACKET_CODES[static_cast<unsigned char>(c)]; }
+
+// Walks [from, to) until the running depth of one bracket kind drops to zero.
+std::optional<size_t> scanForward(const PieceTable &table, size_t from, size_t to, int kind, int64_t &depth) {
+    if (from >= to) {
+        return std::nullopt;
+    }
+    TextIterator it = table.iteratorAt(from);
+    size_t left = to - from;
+    bool found = false;
+    it.skipForward([&](char c) {
+        if (left == 0) {
+            return false;
+        }
+        left--;
+        const BracketCode &code = codeOf(c);
+        if (code.kind == kind && (depth += code.value) == 0) {
+            found = true;
+            return false;
+        }
+        return true;
+    });
+    return found ? std::optional<size_t>(it.getIndex()) : std::nullopt;
+}
+
+// Walks [from, to) right to left, with closing brackets deepening and opening ones resolving.
+std::optional<size_t> scanBackward(const PieceTable &table, size_t from, size_t to, int kind, int64_t &depth) {
+    if (from >= to) {
+        return std::nullopt;
+    }
+    TextIterator it = table.iteratorAt(to - 1);
+    size_t left = to - from;
+    bool found = false;
+    it.skipBackward([&](char c) {
+        if (left == 0) {
+            return false;
+        }
+        left--;
+        const BracketCode &code = codeOf(c);
+        if (code.kind == kind && (depth -= code.value) == 0) {
+            found = true;
+            return false;
+        }
+        return true;
+    });
+    return found ? std::optional<size_t>(it.getIndex()) : std::nullopt;
+}
+}
+
+bool BracketIndex::isBracket(char c) { return codeOf(c).kind >= 0; }
+
+void BracketIndex::rebuild(const PieceTable &table) {
+    chunks.clear();
+    size_t total = table.getTotalLength();
+    for (size_t start = 0; start < total; start += BRACKET_CHUNK_SIZE) {
+        chunks.push_back(Block{std::min(BRACKET_CHUNK_SIZE, total - start), {}});
+        rescan(table, chunks.size() - 1, start);
+    }
+    rebuildTree();
+    valid = true;
+}
+
+void BracketIndex::rebuildTree() {
+    leaf_count = 1;
+    while (leaf_count < chunks.size()) {
+        leaf_count *= 2;
+    }
+    tree.assign(2 * leaf_count, Block{0, {}});
+    std::copy(chunks.begin(), chunks.end(), tree.begin() + leaf_count);
+    for (size_t node = leaf_count - 1; node > 0; node--) {
+        combine(node);
+    }
+}
+
+void BracketIndex::combine(size_t node) {
+    const Block &left = tree[2 * node];
+    const Block &right = tree[2 * node + 1];
+    Block &parent = tree[node];
+    parent.length = left.length + right.length;
+    for (int kind = 0; kind < KINDS; kind++) {
+        parent.balance[kind].net = left.balance[kind].net + right.balance[kind].net;
+        parent.balance[kind].min_prefix =
+            std::min(left.balance[kind].min_prefix, left.balance[kind].net + right.balance[kind].min_prefix);
+    }
+}
+
+void BracketIndex::updateLeaf(size_t chunk) {
+    size_t node = leaf_count + chunk;
+    tree[node] = chunks[chunk];
+    for (node /= 2; node > 0; node /= 2) {
+        combine(node);
+    }
+}
+
+void BracketIndex::rescan(const PieceTable &table, size_t chunk, size_t start) {
+    Block &block = chunks[chunk];
+    block.balance = {};
+    if (block.length == 0) {
+        return;
+    }
+    TextIterator it = table.iteratorAt(start);
+    size_t left = block.length;
+    it.skipForward([&](char c) {
+        if (left == 0) {
+            return false;
+        }
+        left--;
+        const BracketCode &code = codeOf(c);
+        if (code.kind >= 0) {
+            Balance &balance = block.balance[code.kind];
+            balance.net += code.value;
+            balance.min_prefix = std::min(balance.min_prefix, balance.net);
+        }
+        return true;
+    });
+}
+
+std::pair<size_t, size_t> BracketIndex::locate(size_t index) const {
+    if (index >= tree[1].length) {
+        return {chunks.size() - 1, tree[1].length - chunks.back().length};
+    }
+    size_t node = 1;
+    size_t start = 0;
+    while (node < leaf_count) {
+        if (index < tree[2 * node].length) {
+            node = 2 * node;
+        } else {
+            index -= tree[2 * node].length;
+            start += tree[2 * node].length;
+            node = 2 * node + 1;
+        }
+    }
+    return {node - leaf_count, start};
+}
+
+size_t BracketIndex::chunkStart(size_t chunk) const {
+    size_t start = 0;
+    for (size_t node = leaf_count + chunk; node > 1; node /= 2) {
+        if (node % 2 == 1) {
+            start += tree[node - 1].length;
+        }
+    }
+    return start;
+}
+
+// The table already holds the result. Chunks the erase empties are dropped, and a chunk the
+// insertion overgrows is split in place, so the chunk list is spliced once per edit.
+void BracketIndex::onReplace(const PieceTable &table, size_t index, size_t erased, size_t inserted) {
+    if (!valid || (erased == 0 && inserted == 0)) {
+        return;
+    }
+    if (chunks.empty()) {
+        rebuild(table);
+        return;
+    }
+    auto [first, start] = locate(index);
+    size_t last = first;
+    size_t offset = index - start;
+    for (size_t remaining = erased;;) {
+        size_t take = std::min(chunks[last].length - offset, remaining);
+        chunks[last].length -= take;
+        remaining -= take;
+        if (remaining == 0 || last + 1 == chunks.size()) {
+            break;
+        }
+        last++;
+        offset = 0;
+    }
+
+    size_t length = chunks[first].length + inserted;
+    size_t parts = length > 2 * BRACKET_CHUNK_SIZE ? (length + BRACKET_CHUNK_SIZE - 1) / BRACKET_CHUNK_SIZE : 1;
+    if (parts > 1) {
+        chunks.insert(chunks.begin() + first + 1, parts - 1, Block{0, {}});
+        last += parts - 1;
+    }
+    for (size_t i = 0; i < parts; i++) {
+        chunks[first + i].length = parts > 1 ? std::min(BRACKET_CHUNK_SIZE, length - i * BRACKET_CHUNK_SIZE) : length;
+        rescan(table, first + i, start + i * BRACKET_CHUNK_SIZE);
+    }
+    if (last == first) {
+        updateLeaf(first);
+        return;
+    }
+    if (last >= first + parts) {
+        rescan(table, last, start + length);
+    }
+    auto begin = chunks.begin() + first;
+    auto end = chunks.begin() + last + 1;
+    chunks.erase(std::remove_if(begin, end, [](const Block &block) { return block.length == 0; }), end);
+    rebuildTree();
+}
+
+size_t BracketIndex::searchForward(size_t node, size_t lo, size_t hi, size_t from, int kind, int64_t &depth) const {
+    if (hi <= from) {
+        return NOT_FOUND;
+    }
+    const Balance &balance = tree[node].balance[kind];
+    if (lo >= from && depth + balance.min_prefix > 0) {
+        depth += balance.net;
+        return NOT_FOUND;
+    }
+    if (node >= leaf_count) {
+        return node - leaf_count;
+    }
+    size_t mid = (lo + hi) / 2;
+    size_t found = searchForward(2 * node, lo, mid, from, kind, depth);
+    return found != NOT_FOUND ? found : searchForward(2 * node + 1, mid, hi, from, kind, depth);
+}
+
+size_t BracketIndex::searchBackward(size_t node, size_t lo, size_t hi, size_t before, int kind, int64_t &depth) const {
+    if (lo >= before) {
+        return NOT_FOUND;
+    }
+    const Balance &balance = tree[node].balance[kind];
+    int64_t max_suffix = balance.net - balance.min_prefix;
+    if (hi <= before && depth - max_suffix > 0) {
+        depth -= balance.net;
+        return NOT_FOUND;
+    }
+    if (node >= leaf_count) {
+        return node - leaf_count;
+    }
+    size_t mid = (lo + hi) / 2;
+    size_t found = searchBackward(2 * node + 1, mid, hi, before, kind, depth);
+    return found != NOT_FOUND ? found : searchBackward(2 * node, lo, mid, before, kind, depth);
+}
+
+std::optional<size_t> BracketIndex::matchForward(const PieceTable &table, size_t from, int kind, int64_t depth) const {
+    if (chunks.empty() || from >= tree[1].length) {
+        return std::nullopt;
+    }
+    auto [chunk, start] = locate(from);
+    if (auto match = scanForward(table, from, start + chunks[chunk].length, kind, depth)) {
+        return match;
+    }
+    size_t found = searchForward(1, 0, leaf_count, chunk + 1, kind, depth);
+    if (found == NOT_FOUND) {
+        return std::nullopt;
+    }
+    size_t found_start = chunkStart(found);
+    return scanForward(table, found_start, found_start + chunks[found].length, kind, depth);
+}
+
+std::optional<size_t> BracketIndex::matchBackward(const PieceTable &table, size_t before, int kind, int64_t depth) const {
+    if (chunks.empty() || before == 0) {
+        return std::nullopt;
+    }
+    auto [chunk, start] = locate(before - 1);
+    if (auto match = scanBackward(table, start, before, kind, depth)) {
+        return match;
+    }
+    size_t found = searchBackward(1, 0, leaf_count, chunk, kind, depth);
+    if (found == NOT_FOUND) {
+        return std::nullopt;
+    }
+    size_t found_start = chunkStart(found);
+    return scanBackward(table, found_start, found_start + chunks[found].length, kind, depth);
+}
+
+std::optional<size_t> BracketIndex::findMatch(const PieceTable &table, size_t index) {
+    auto c = index < table.getTotalLength() ? table.getCharacterFromCursor(index) : std::nullopt;
+    if (!c || codeOf(*c).kind < 0) {
+        return std::nullopt;
+    }
+    if (!valid) {
+        rebuild(table);
+    }
+    const BracketCode &code = codeOf(*c);
+    if (code.value > 0) {
+        return matchForward(table, index + 1, code.kind, 1);
+    }
+    return matchBackward(table, index, code.kind, 1);
+}
+
+std::optional<size_t> BracketIndex::findEnclosingOpen(const PieceTable &table, size_t index) {
+    if (!valid) {
+        rebuild(table);
+    }
+    std::optional<size_t> nearest;
+    for (int kind = 0; kind < KINDS; kind++) {
+        auto open = matchBackward(table, index, kind, 1);
+        if (open && (!nearest || *open > *nearest)) {
+            nearest = open;
+        }
+    }
+    return nearest;
+}
+}
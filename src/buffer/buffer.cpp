@@ -1,89 +1,319 @@
 #include <algorithm>
+#include <atomic>
 #include <blip/buffer/buffer.hpp>
+#include <blip/buffer/iterator.hpp>
+#include <blip/buffer/motion.hpp>
 
 namespace buffer {
 
-EditorBuffer::EditorBuffer(const std::string &initial_text) : table(initial_text), cursor_pos(0) {
-    updateLineStarts(initial_text);
+EditorBuffer::EditorBuffer(const std::string &initial_text)
+    : table(initial_text), cursor_pos(0), line_starts(std::make_shared<std::vector<size_t>>()) {
+    buildLineStarts(initial_text);
+    indents.reset(line_starts->size());
     commit();
 }
 
-void EditorBuffer::updateLineStarts(const std::string &text) {
-    if (line_starts.empty()) {
-        line_starts.push_back(0);
-        for (size_t i = 0; i < text.length(); i++) {
-            if (text[i] == '\n') {
-                line_starts.push_back(i + 1);
-            }
-        }
+std::vector<size_t> &EditorBuffer::mutableLineStarts() {
+    if (line_starts.use_count() > 1) {
+        line_starts = std::make_shared<std::vector<size_t>>(*line_starts);
     } else {
-        size_t pushed = 0;
-        auto it = std::upper_bound(line_starts.begin(), line_starts.end(), cursor_pos);
-        size_t push_idx = std::distance(line_starts.begin(), it);
-
-        for (size_t i = 0; i < text.size(); i++) {
-            if (text[i] == '\n') {
-                line_starts.insert(line_starts.begin() + push_idx + pushed, cursor_pos + i + 1);
-                pushed++;
-            }
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return const_cast<std::vector<size_t> &>(*line_starts);
+}
+
+void EditorBuffer::buildLineStarts(const std::string &text) {
+    auto &line_starts = mutableLineStarts();
+    line_starts.assign(1, 0);
+    for (size_t i = 0; i < text.length(); i++) {
+        if (text[i] == '\n') {
+            line_starts.push_back(i + 1);
+        }
+    }
+}
+
+size_t EditorBuffer::lineStart(size_t row) const {
+    return (*line_starts)[row] + (row >= pending_row ? pending_delta : 0);
+}
+
+size_t EditorBuffer::rowOf(size_t index) const {
+    size_t low = 0, high = line_starts->size();
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (lineStart(mid) <= index) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low - 1;
+}
+
+// Rows at or after pending_row still owe pending_delta (modulo 2^64, so it may "go negative").
+// Only the rows between the previous and the current edit are settled, so edits walking through
+// the file cost the distance between them rather than the length of the file.
+void EditorBuffer::shiftLineStarts(size_t from_row, size_t delta) {
+    auto &line_starts = mutableLineStarts();
+    if (pending_row == SIZE_MAX) {
+        pending_row = from_row;
+        pending_delta = delta;
+    } else if (from_row >= pending_row) {
+        for (size_t j = pending_row; j < from_row; j++) {
+            line_starts[j] += pending_delta;
         }
-        for (size_t j = push_idx + pushed; j < line_starts.size(); j++) {
-            line_starts[j] += text.length();
+        pending_row = from_row;
+        pending_delta += delta;
+    } else {
+        for (size_t j = from_row; j < pending_row; j++) {
+            line_starts[j] += delta;
         }
+        pending_delta += delta;
     }
 }
 
-void EditorBuffer::recomputeAllLines() {
-    line_starts.clear();
-    updateLineStarts(table.getText());
+void EditorBuffer::settleLineStarts() {
+    if (pending_row == SIZE_MAX) {
+        return;
+    }
+    auto &line_starts = mutableLineStarts();
+    for (size_t j = pending_row; j < line_starts.size(); j++) {
+        line_starts[j] += pending_delta;
+    }
+    pending_row = SIZE_MAX;
+    pending_delta = 0;
 }
 
 void EditorBuffer::commit() {
+    if (transaction_depth > 0) {
+        return;
+    }
     if (!redo_stack.empty()) {
         redo_stack.clear();
     }
+    settleLineStarts();
     undo_stack.push_back(EditRecord{table.getState(), cursor_pos, line_starts});
 }
 
+void EditorBuffer::beginTransaction() {
+    if (transaction_depth == 0) {
+        commit();
+    }
+    transaction_depth++;
+}
+
+void EditorBuffer::endTransaction() {
+    if (transaction_depth > 0) {
+        transaction_depth--;
+    }
+}
+
 void EditorBuffer::undo() {
     if (undo_stack.empty())
         return;
-    redo_stack.push_back(EditRecord{table.getState(), cursor_pos, line_starts});
-    EditRecord record = std::move(undo_stack.back());
-    table.restoreState(record.table_state);
-    setCursor(record.cursor_position);
-    line_starts = record.line_starts;
-    undo_stack.pop_back();
+    restore(undo_stack, redo_stack);
 }
 
 void EditorBuffer::redo() {
     if (redo_stack.empty())
         return;
-    undo_stack.push_back(EditRecord{table.getState(), cursor_pos, line_starts});
-    EditRecord record = std::move(redo_stack.back());
+    restore(redo_stack, undo_stack);
+}
+
+// Pops the state to return to off from and pushes the current one onto to. The indexes are told
+// about the changed range as if it had been replaced, so undoing one keystroke in a large file
+// rescans and remeasures only the lines around it.
+void EditorBuffer::restore(std::vector<EditRecord> &from, std::vector<EditRecord> &to) {
+    settleLineStarts();
+    EditRecord record = std::move(from.back());
+    from.pop_back();
+    to.push_back(EditRecord{table.getState(), cursor_pos, line_starts, record.changed_from, record.unchanged_tail});
+    if (record.changed_from == SIZE_MAX) {
+        table.restoreState(record.table_state);
+        line_starts = record.line_starts;
+        setCursor(record.cursor_position);
+        return;
+    }
+
+    size_t old_length = table.getTotalLength();
+    size_t offset = record.changed_from;
+    size_t first_row = rowOf(offset);
+    size_t tail = std::min(record.unchanged_tail, old_length - offset);
+    size_t last_row = rowOf(old_length - tail);
     table.restoreState(record.table_state);
-    setCursor(record.cursor_position);
     line_starts = record.line_starts;
-    redo_stack.pop_back();
+    size_t new_length = table.getTotalLength();
+    tail = std::min(tail, new_length - offset);
+    size_t removed = last_row - first_row;
+    size_t added = rowOf(new_length - tail) - first_row;
+
+    indents.onErase(first_row, removed);
+    indents.onInsert(first_row, added);
+    wraps.onErase(first_row, removed);
+    wraps.onInsert(first_row, added);
+    damageRows(first_row, added == removed ? last_row + 1 : SIZE_MAX);
+    brackets.onReplace(table, offset, old_length - tail - offset, new_length - tail - offset);
+    setCursor(record.cursor_position);
+    version++;
 }
 
 std::string EditorBuffer::getText() const { return table.getText(); }
 
+std::optional<std::pair<size_t, size_t>> EditorBuffer::takeDamagedRows() {
+    if (damage_first == SIZE_MAX) {
+        return std::nullopt;
+    }
+    std::pair<size_t, size_t> rows = {damage_first, damage_last};
+    damage_first = SIZE_MAX;
+    damage_last = 0;
+    return rows;
+}
+
+void EditorBuffer::damageRows(size_t first, size_t last) {
+    damage_first = std::min(damage_first, first);
+    damage_last = std::max(damage_last, last);
+}
+
+Snapshot EditorBuffer::snapshot() const {
+    Snapshot snap = table.snapshot();
+    snap.line_starts = line_starts;
+    snap.pending_row = pending_row;
+    snap.pending_delta = pending_delta;
+    snap.version = version;
+    return snap;
+}
+
+uint64_t EditorBuffer::getVersion() const { return version; }
+
+bool EditorBuffer::isModified() const { return version != saved_version; }
+
+void EditorBuffer::markSaved() { saved_version = version; }
+
+bool EditorBuffer::hasEdits() const { return version != 0; }
+
+// Undo records that share state are counted once per record, so this is an upper bound.
+size_t EditorBuffer::getMemoryUsage() const {
+    size_t usage = table.getMemoryUsage() + line_starts->capacity() * sizeof(size_t);
+    for (const auto *stack : {&undo_stack, &redo_stack}) {
+        usage += stack->capacity() * sizeof(EditRecord);
+        for (const auto &record : *stack) {
+            usage += record.table_state.pieces->capacity() * sizeof(Piece);
+            usage += record.line_starts->capacity() * sizeof(size_t);
+        }
+    }
+    return usage;
+}
+
 size_t EditorBuffer::getCursor() const { return cursor_pos; }
 
 size_t EditorBuffer::getTotalLength() const { return table.getTotalLength(); }
 
+size_t EditorBuffer::getLineCount() const { return line_starts->size(); }
+
+size_t EditorBuffer::getLineStart(size_t row) const { return lineStart(row); }
+
+size_t EditorBuffer::getLineFromIndex(size_t index) const { return rowOf(index); }
+
+TextIterator EditorBuffer::iteratorAt(size_t index) const { return table.iteratorAt(index); }
+
+void EditorBuffer::setTabWidth(size_t width) {
+    indents.setTabWidth(width);
+    wraps.configure(wraps.getWidth(), indents.getTabWidth(), line_starts->size());
+}
+
+std::optional<size_t> EditorBuffer::getIndentWidth(size_t row) {
+    if (row >= line_starts->size()) {
+        return std::nullopt;
+    }
+    int32_t width = indents.getWidth(table, row, lineStart(row));
+    if (width == IndentCache::BLANK) {
+        return std::nullopt;
+    }
+    return width;
+}
+
+size_t EditorBuffer::getCarriedIndent(size_t row) {
+    size_t stop = row > IndentCache::CARRY_LIMIT ? row - IndentCache::CARRY_LIMIT : 0;
+    while (row-- > stop) {
+        if (auto width = getIndentWidth(row)) {
+            return *width;
+        }
+    }
+    return 0;
+}
+
+void EditorBuffer::setWrapWidth(size_t columns) {
+    wraps.configure(columns, indents.getTabWidth(), line_starts->size());
+}
+
+size_t EditorBuffer::getVisualRowCount() const {
+    return wraps.isEnabled() ? wraps.getRowCount() : line_starts->size();
+}
+
+size_t EditorBuffer::getVisualRow(size_t row) const { return wraps.getVisualRow(row); }
+
+// Reads the line's current count without measuring, so the rows of an unmeasured line are estimates.
+size_t EditorBuffer::getVisualRowOf(size_t index) const {
+    size_t row = rowOf(index);
+    if (!wraps.isEnabled()) {
+        return row;
+    }
+    size_t start = lineStart(row);
+    size_t first = wraps.getVisualRow(row), rows = wraps.getVisualRow(row + 1) - first;
+    return first + std::min(rows - 1, wraps.subRowOf(table, start, start + getLineLength(row), index));
+}
+
+std::pair<size_t, size_t> EditorBuffer::locateVisualRow(size_t visual_row) const {
+    return wraps.locate(visual_row);
+}
+
+void EditorBuffer::measureWrap(size_t row, size_t rows_before, size_t rows_after) {
+    if (!wraps.isEnabled()) {
+        return;
+    }
+    auto measure = [&](size_t line) {
+        size_t start = lineStart(line);
+        auto [rows, changed] = wraps.measure(table, line, start, start + getLineLength(line));
+        if (changed) {
+            damageRows(line, SIZE_MAX);
+        }
+        return rows;
+    };
+    size_t covered = 0;
+    for (size_t line = std::min(row, line_starts->size()); line-- > 0 && covered < rows_before;) {
+        covered += measure(line);
+    }
+    covered = 0;
+    for (size_t line = row; line < line_starts->size() && covered < rows_after; line++) {
+        covered += measure(line);
+    }
+}
+
+bool EditorBuffer::refineWrap(size_t budget) {
+    size_t spent = 0;
+    while (spent < budget) {
+        size_t row = wraps.nextUnmeasured();
+        if (row == SIZE_MAX) {
+            return false;
+        }
+        size_t start = lineStart(row);
+        size_t length = getLineLength(row);
+        wraps.measure(table, row, start, start + length);
+        spent += length + 1;
+    }
+    return true;
+}
+
 void EditorBuffer::setCursorToBeginningColumn() {
     auto [row, _] = getCursorPosition2D();
-    setCursor(line_starts[row]);
+    setCursor(lineStart(row));
 }
 
 void EditorBuffer::setCursorToEndingColumn() {
     auto [row, _] = getCursorPosition2D();
-    if (row == line_starts.size() - 1) {
+    if (row == line_starts->size() - 1) {
         setCursor(table.getTotalLength());
     } else {
-        setCursor(line_starts[row + 1] - 1);
+        setCursor(lineStart(row + 1) - 1);
     }
 }
 
@@ -97,71 +327,242 @@ void EditorBuffer::setCursor(Sint64 new_pos) {
     }
 }
 
-void EditorBuffer::insertText(const std::string &text) {
-    if (text.empty()) {
+void EditorBuffer::insertText(const std::string &text) { replace(cursor_pos, 0, text); }
+
+void EditorBuffer::backspace(size_t amount) {
+    if (cursor_pos < amount) {
+        amount = cursor_pos;
+    }
+    eraseRange(cursor_pos - amount, cursor_pos);
+}
+
+void EditorBuffer::eraseRange(size_t start, size_t end) { replace(start, end - std::min(start, end), ""); }
+
+// One piece splice and one line-index splice, whatever the size of the range or the text.
+void EditorBuffer::replace(size_t offset, size_t length, const std::string &text) {
+    offset = std::min(offset, table.getTotalLength());
+    length = std::min(length, table.getTotalLength() - offset);
+    if (length == 0 && text.empty()) {
         return;
     }
-    updateLineStarts(text);
-    table.insert(cursor_pos, text);
-    setCursor(cursor_pos + text.length());
+    size_t first_row = rowOf(offset);
+    size_t last_row = rowOf(offset + length);
+    size_t removed = last_row - first_row;
+    size_t added = std::count(text.begin(), text.end(), '\n');
+    indents.onErase(first_row, removed);
+    indents.onInsert(first_row, added);
+    wraps.onErase(first_row, removed);
+    wraps.onInsert(first_row, added);
+    damageRows(first_row, added == removed ? last_row + 1 : SIZE_MAX);
+
+    shiftLineStarts(last_row + 1, text.length() - length);
+    auto &line_starts = mutableLineStarts();
+    auto next = line_starts.begin() + first_row + 1;
+    if (added > removed) {
+        next = line_starts.insert(line_starts.begin() + last_row + 1, added - removed, 0) - removed;
+    } else if (removed > added) {
+        line_starts.erase(next + added, next + removed);
+    }
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '\n') {
+            *next++ = offset + i + 1;
+        }
+    }
+    pending_row = pending_row + added - removed;
+
+    // The records next to the current state learn what this edit changed.
+    for (auto *stack : {&undo_stack, &redo_stack}) {
+        if (!stack->empty()) {
+            EditRecord &record = stack->back();
+            record.changed_from = std::min(record.changed_from, offset);
+            record.unchanged_tail = std::min(record.unchanged_tail, table.getTotalLength() - offset - length);
+        }
+    }
+    table.replace(offset, length, text);
+    brackets.onReplace(table, offset, length, text.length());
+    version++;
+
+    if (cursor_pos >= offset + length) {
+        cursor_pos = cursor_pos - length + text.length();
+    } else if (cursor_pos > offset) {
+        cursor_pos = offset;
+    }
     auto [_, col] = getCursorPosition2D();
     desired_col = col;
 }
 
-void EditorBuffer::backspace(size_t amount) {
-    if (amount == 0 || cursor_pos == 0) {
+void EditorBuffer::overwrite(const std::string &text) {
+    // Replace as many characters as the text has, never reaching past the end of the line
+    size_t chars = std::count_if(text.begin(), text.end(), [](char c) { return (c & 0xC0) != 0x80; });
+    TextIterator it = table.iteratorAt(cursor_pos);
+    it.skipForward([&](char c) {
+        if (c == '\n') {
+            return false;
+        }
+        if ((c & 0xC0) != 0x80) {
+            if (chars == 0) {
+                return false;
+            }
+            chars--;
+        }
+        return true;
+    });
+    size_t offset = cursor_pos;
+    replace(offset, it.getIndex() - offset, text);
+    jumpTo(offset + text.length());
+}
+
+void EditorBuffer::moveLeft(size_t count) {
+    size_t current_pos = cursor_pos;
+    setCursor(static_cast<Sint64>(cursor_pos) - static_cast<Sint64>(count));
+    desired_col -= std::min(desired_col, current_pos - cursor_pos);
+}
+void EditorBuffer::moveRight(size_t count) {
+    size_t current_pos = cursor_pos;
+    setCursor(cursor_pos + count);
+    desired_col += cursor_pos - current_pos;
+}
+void EditorBuffer::moveUp(size_t count) {
+    auto [row, _] = getCursorPosition2D();
+    if (row == 0) {
         return;
     }
-    if (cursor_pos < amount) {
-        amount = cursor_pos;
+    setCursor(getCursorPositionFrom2D(row - std::min(row, count), desired_col));
+}
+void EditorBuffer::moveDown(size_t count) {
+    auto [row, _] = getCursorPosition2D();
+    if (row == line_starts->size() - 1) {
+        return;
+    }
+    setCursor(getCursorPositionFrom2D(std::min(row + count, line_starts->size() - 1), desired_col));
+}
+
+void EditorBuffer::gotoLine(size_t row) { jumpTo(lineStart(std::min(row, line_starts->size() - 1))); }
+
+// Both deletes are a single erase, so a count costs one line-index update and one piece change.
+void EditorBuffer::deleteLines(size_t count) {
+    size_t row = getCursorPosition2D().first;
+    size_t last = std::min(row + count, line_starts->size());
+    size_t start = lineStart(row);
+    size_t end = last < line_starts->size() ? lineStart(last) : table.getTotalLength();
+    if (last == line_starts->size() && row > 0) {
+        start--;
+    }
+    if (end == start) {
+        return;
+    }
+    setCursor(end);
+    backspace(end - start);
+    jumpTo(lineStart(rowOf(cursor_pos)));
+}
+
+void EditorBuffer::deleteChars(size_t count) {
+    size_t row = getCursorPosition2D().first;
+    size_t line_end = row + 1 < line_starts->size() ? lineStart(row + 1) - 1 : table.getTotalLength();
+    size_t amount = std::min(count, line_end - cursor_pos);
+    if (amount == 0) {
+        return;
     }
-    table.erase(cursor_pos, amount);
-    setCursor(cursor_pos - amount);
-    recomputeAllLines();
+    size_t col = desired_col;
+    setCursor(cursor_pos + amount);
+    backspace(amount);
+    desired_col = col;
+}
+
+void EditorBuffer::jumpTo(size_t index) {
+    setCursor(index);
     auto [_, col] = getCursorPosition2D();
     desired_col = col;
 }
 
-void EditorBuffer::moveLeft() {
-    int current_pos = cursor_pos;
-    setCursor(cursor_pos - 1);
-    if (cursor_pos < current_pos) {
-        desired_col--;
-    }
+void EditorBuffer::moveWordForward(size_t count, bool big_word) {
+    jumpTo(motion::nextWordStart(table, cursor_pos, count, big_word));
 }
-void EditorBuffer::moveRight() {
-    int current_pos = cursor_pos;
-    setCursor(cursor_pos + 1);
-    if (cursor_pos > current_pos) {
-        desired_col++;
+
+void EditorBuffer::moveWordBackward(size_t count, bool big_word) {
+    jumpTo(motion::prevWordStart(table, cursor_pos, count, big_word));
+}
+
+void EditorBuffer::moveWordEnd(size_t count, bool big_word) { jumpTo(motion::nextWordEnd(table, cursor_pos, count, big_word)); }
+
+std::pair<size_t, size_t> EditorBuffer::getWordObject(bool around, bool big_word) const {
+    return motion::wordObject(table, cursor_pos, around, big_word);
+}
+
+std::optional<size_t> EditorBuffer::findMatchingBracket(size_t index) { return brackets.findMatch(table, index); }
+
+std::optional<std::pair<size_t, size_t>> EditorBuffer::findEnclosingScope(size_t index) {
+    auto open = brackets.findEnclosingOpen(table, index);
+    if (!open) {
+        return std::nullopt;
+    }
+    auto close = brackets.findMatch(table, *open);
+    if (!close) {
+        return std::nullopt;
     }
+    return std::make_pair(*open, *close);
 }
-void EditorBuffer::moveUp() {
+
+bool EditorBuffer::jumpToMatchingBracket() {
     auto [row, _] = getCursorPosition2D();
-    if (row == 0) {
-        return;
+    size_t left = getLineLength(row) - (cursor_pos - lineStart(row));
+    bool found = false;
+    TextIterator it = table.iteratorAt(cursor_pos);
+    it.skipForward([&](char c) {
+        if (left == 0) {
+            return false;
+        }
+        if (BracketIndex::isBracket(c)) {
+            found = true;
+            return false;
+        }
+        left--;
+        return true;
+    });
+    if (!found) {
+        return false;
+    }
+    auto match = brackets.findMatch(table, it.getIndex());
+    if (!match) {
+        return false;
     }
-    setCursor(getCursorPositionFrom2D(row - 1, desired_col));
+    jumpTo(*match);
+    return true;
 }
-void EditorBuffer::moveDown() {
+
+size_t EditorBuffer::getLineLength(size_t row) const {
+    if (row + 1 < line_starts->size()) {
+        return lineStart(row + 1) - lineStart(row) - 1;
+    }
+    return table.getTotalLength() - lineStart(row);
+}
+
+std::pair<size_t, size_t> EditorBuffer::getParagraphObject() const {
     auto [row, _] = getCursorPosition2D();
-    if (row == line_starts.size() - 1) {
-        return;
+    bool blank = getLineLength(row) == 0;
+    size_t top = row;
+    while (top > 0 && (getLineLength(top - 1) == 0) == blank) {
+        top--;
+    }
+    size_t bottom = row;
+    while (bottom + 1 < line_starts->size() && (getLineLength(bottom + 1) == 0) == blank) {
+        bottom++;
     }
-    setCursor(getCursorPositionFrom2D(row + 1, desired_col));
+    size_t end = bottom + 1 < line_starts->size() ? lineStart(bottom + 1) : table.getTotalLength();
+    return {lineStart(top), end};
 }
 
 size_t EditorBuffer::getCursorPositionFrom2D(size_t row, size_t col) const {
-    if (line_starts.empty()) {
+    if (line_starts->empty()) {
         return 0;
     }
-    if (row >= line_starts.size()) {
-        row = line_starts.size() - 1;
+    if (row >= line_starts->size()) {
+        row = line_starts->size() - 1;
     }
-    size_t line_start_index = line_starts[row];
+    size_t line_start_index = lineStart(row);
     size_t next_line_start;
-    if (row + 1 < line_starts.size()) {
-        next_line_start = line_starts[row + 1];
+    if (row + 1 < line_starts->size()) {
+        next_line_start = lineStart(row + 1);
     } else {
         next_line_start = table.getTotalLength() + 1;
     }
@@ -176,12 +577,11 @@ size_t EditorBuffer::getCursorPositionFrom2D(size_t row, size_t col) const {
 }
 
 std::pair<size_t, size_t> EditorBuffer::getCursorPosition2D() const {
-    if (line_starts.empty()) {
+    if (line_starts->empty()) {
         return {0, 0};
     }
-    auto it = std::upper_bound(line_starts.begin(), line_starts.end(), cursor_pos);
-    size_t row = std::distance(line_starts.begin(), it) - 1;
-    size_t col = cursor_pos - line_starts[row];
+    size_t row = rowOf(cursor_pos);
+    size_t col = cursor_pos - lineStart(row);
     return {row, col};
 }
 }
@@ -0,0 +1,47 @@
+#include <blip/buffer/indent.hpp>
+#include <blip/buffer/iterator.hpp>
+
+namespace buffer {
+
+void IndentCache::reset(size_t line_count) { widths.assign(line_count, UNKNOWN); }
+
+void IndentCache::setTabWidth(size_t width) {
+    if (width == 0 || width == tab_width) {
+        return;
+    }
+    tab_width = width;
+    reset(widths.size());
+}
+
+size_t IndentCache::getTabWidth() const { return tab_width; }
+
+void IndentCache::onInsert(size_t row, size_t new_lines) {
+    widths[row] = UNKNOWN;
+    widths.insert(widths.begin() + row + 1, new_lines, UNKNOWN);
+}
+
+void IndentCache::onErase(size_t row, size_t removed_lines) {
+    widths.erase(widths.begin() + row + 1, widths.begin() + row + 1 + removed_lines);
+    widths[row] = UNKNOWN;
+}
+
+int32_t IndentCache::getWidth(const PieceTable &table, size_t row, size_t line_start) {
+    if (widths[row] != UNKNOWN) {
+        return widths[row];
+    }
+    int32_t width = 0;
+    TextIterator it = table.iteratorAt(line_start);
+    bool content = it.skipForward([&](char c) {
+        if (c == ' ') {
+            width++;
+        } else if (c == '\t') {
+            width += tab_width - width % tab_width;
+        } else {
+            return false;
+        }
+        return true;
+    });
+    widths[row] = content && it.get() != '\n' ? width : BLANK;
+    return widths[row];
+}
+}
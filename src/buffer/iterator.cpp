@@ -0,0 +1,17 @@
+#include <blip/buffer/iterator.hpp>
+
+namespace buffer {
+
+TextIterator::TextIterator(const std::vector<Piece> &pieces, const char *original_data, const char *add_data, size_t index)
+    : pieces(&pieces), original_data(original_data), add_data(add_data) {
+    size_t curr_length = 0;
+    for (; piece < pieces.size(); piece++) {
+        if (curr_length + pieces[piece].length > index) {
+            offset = index - curr_length;
+            break;
+        }
+        curr_length += pieces[piece].length;
+    }
+    this->index = piece < pieces.size() ? index : curr_length;
+}
+}
@@ -0,0 +1,132 @@
+#include <blip/buffer/manager.hpp>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace buffer {
+
+namespace {
+std::string readWholeFile(const std::filesystem::path &path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open()) {
+        return "";
+    }
+    return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+}
+
+BufferManager::BufferManager(size_t memory_budget) : memory_budget(memory_budget) {}
+
+size_t BufferManager::open(const std::string &path) {
+    for (size_t id = 0; id < entries.size(); id++) {
+        if (entries[id].path == path) {
+            focus(id);
+            return id;
+        }
+    }
+    entries.push_back(BufferEntry{path, std::make_unique<EditorBuffer>(readWholeFile(path)), 0, ++clock});
+    active_id = entries.size() - 1;
+    enforceBudget();
+    return active_id;
+}
+
+EditorBuffer &BufferManager::focus(size_t id) {
+    if (entries.empty()) {
+        open("");
+    }
+    if (id >= entries.size()) {
+        id = entries.size() - 1;
+    }
+    active_id = id;
+    auto &entry = entries[id];
+    entry.last_used = ++clock;
+    if (!entry.buffer) {
+        materialize(entry);
+        enforceBudget();
+    }
+    return *entry.buffer;
+}
+
+EditorBuffer &BufferManager::active() { return focus(active_id); }
+
+bool BufferManager::save(size_t id) {
+    auto &entry = entries[id];
+    if (!entry.buffer || entry.path.empty()) {
+        return false;
+    }
+    std::string text = entry.buffer->getText();
+    std::ofstream f(entry.path, std::ios::binary | std::ios::trunc);
+    if (!f.write(text.data(), (std::streamsize)text.size())) {
+        std::cerr << "Could not save " << entry.path << std::endl;
+        return false;
+    }
+    entry.buffer->markSaved();
+    return true;
+}
+
+void BufferManager::focusNext() {
+    if (!entries.empty()) {
+        focus((active_id + 1) % entries.size());
+    }
+}
+
+void BufferManager::focusPrevious() {
+    if (!entries.empty()) {
+        focus((active_id + entries.size() - 1) % entries.size());
+    }
+}
+
+size_t BufferManager::getActiveId() const { return active_id; }
+
+size_t BufferManager::getBufferCount() const { return entries.size(); }
+
+const std::string &BufferManager::getPath(size_t id) const { return entries[id].path; }
+
+bool BufferManager::isResident(size_t id) const { return id < entries.size() && entries[id].buffer != nullptr; }
+
+size_t BufferManager::getResidentBytes() const {
+    size_t total = 0;
+    for (const auto &entry : entries) {
+        if (entry.buffer) {
+            total += entry.buffer->getMemoryUsage();
+        }
+    }
+    return total;
+}
+
+void BufferManager::setMemoryBudget(size_t bytes) {
+    memory_budget = bytes;
+    enforceBudget();
+}
+
+void BufferManager::enforceBudget() {
+    size_t resident = getResidentBytes();
+    while (resident > memory_budget) {
+        BufferEntry *coldest = nullptr;
+        for (size_t id = 0; id < entries.size(); id++) {
+            auto &entry = entries[id];
+            if (id == active_id || !entry.buffer || entry.buffer->isModified() || entry.buffer->hasEdits()) {
+                continue;
+            }
+            if (!coldest || entry.last_used < coldest->last_used) {
+                coldest = &entry;
+            }
+        }
+        if (!coldest) {
+            return;
+        }
+        resident -= coldest->buffer->getMemoryUsage();
+        evict(*coldest);
+    }
+}
+
+void BufferManager::evict(BufferEntry &entry) {
+    entry.cursor_position = entry.buffer->getCursor();
+    entry.buffer.reset();
+}
+
+void BufferManager::materialize(BufferEntry &entry) {
+    entry.buffer = std::make_unique<EditorBuffer>(readWholeFile(entry.path));
+    entry.buffer->setCursor(entry.cursor_position);
+}
+}
@@ -0,0 +1,111 @@
+#include <blip/buffer/iterator.hpp>
+#include <blip/buffer/motion.hpp>
+
+namespace buffer::motion {
+
+namespace {
+bool isBlank(char c) { return CHAR_CLASSES[static_cast<unsigned char>(c)] == CharClass::BLANK; }
+
+bool isSpace(char c) {
+    CharClass cls = CHAR_CLASSES[static_cast<unsigned char>(c)];
+    return cls == CharClass::BLANK || cls == CharClass::NEWLINE;
+}
+
+// An empty line is a word of its own for w and b, as in vim.
+bool onEmptyLine(const TextIterator &it) {
+    if (it.atEnd() || it.get() != '\n') {
+        return false;
+    }
+    TextIterator before = it;
+    return !before.prev() || before.get() == '\n';
+}
+}
+
+size_t nextWordStart(const PieceTable &table, size_t index, size_t count, bool big_word) {
+    TextIterator it = table.iteratorAt(index);
+    for (size_t n = 0; n < count && !it.atEnd(); n++) {
+        CharClass start = classOf(it.get(), big_word);
+        if (start == CharClass::WORD || start == CharClass::PUNCT) {
+            it.skipForward([&](char c) { return classOf(c, big_word) == start; });
+        } else if (start == CharClass::NEWLINE) {
+            it.next();
+            if (onEmptyLine(it)) {
+                continue;
+            }
+        }
+        while (it.skipForward(isBlank) && it.get() == '\n') {
+            it.next();
+            if (onEmptyLine(it)) {
+                break;
+            }
+        }
+    }
+    return it.getIndex();
+}
+
+size_t nextWordEnd(const PieceTable &table, size_t index, size_t count, bool big_word) {
+    TextIterator it = table.iteratorAt(index);
+    for (size_t n = 0; n < count; n++) {
+        TextIterator probe = it;
+        if (!probe.next() || !probe.skipForward(isSpace)) {
+            break;
+        }
+        it = probe;
+        CharClass cls = classOf(it.get(), big_word);
+        it.skipForward([&](char c) { return classOf(c, big_word) == cls; });
+        it.prev();
+    }
+    return it.getIndex();
+}
+
+size_t prevWordStart(const PieceTable &table, size_t index, size_t count, bool big_word) {
+    TextIterator it = table.iteratorAt(index);
+    for (size_t n = 0; n < count && it.prev(); n++) {
+        while (isSpace(it.get()) && !onEmptyLine(it)) {
+            if (!it.prev()) {
+                break;
+            }
+        }
+        CharClass cls = classOf(it.get(), big_word);
+        if (cls == CharClass::WORD || cls == CharClass::PUNCT) {
+            if (it.skipBackward([&](char c) { return classOf(c, big_word) == cls; })) {
+                it.next();
+            }
+        }
+    }
+    return it.getIndex();
+}
+
+std::pair<size_t, size_t> wordObject(const PieceTable &table, size_t index, bool around, bool big_word) {
+    TextIterator it = table.iteratorAt(index);
+    if (it.atEnd() || it.get() == '\n') {
+        return {index, index};
+    }
+    CharClass cls = classOf(it.get(), big_word);
+    auto same = [&](char c) { return classOf(c, big_word) == cls; };
+
+    TextIterator back = it;
+    size_t start = back.skipBackward(same) ? back.getIndex() + 1 : 0;
+    TextIterator forward = it;
+    forward.skipForward(same);
+    size_t end = forward.getIndex();
+
+    if (!around) {
+        return {start, end};
+    }
+    if (cls == CharClass::BLANK) {
+        if (!forward.atEnd() && forward.get() != '\n') {
+            CharClass next = classOf(forward.get(), big_word);
+            forward.skipForward([&](char c) { return classOf(c, big_word) == next; });
+            end = forward.getIndex();
+        }
+    } else if (!forward.atEnd() && isBlank(forward.get())) {
+        forward.skipForward(isBlank);
+        end = forward.getIndex();
+    } else if (start > 0) {
+        TextIterator leading = table.iteratorAt(start - 1);
+        start = leading.skipBackward(isBlank) ? leading.getIndex() + 1 : 0;
+    }
+    return {start, end};
+}
+}
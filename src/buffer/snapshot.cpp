@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <blip/buffer/snapshot.hpp>
+
+namespace buffer {
+
+namespace {
+// Every empty snapshot shares these, so a default-constructed one, like the one a layout job is
+// moved into, allocates nothing.
+const std::shared_ptr<const std::vector<Piece>> EMPTY_PIECES = std::make_shared<const std::vector<Piece>>();
+const std::shared_ptr<const std::vector<size_t>> EMPTY_LINE_STARTS = std::make_shared<const std::vector<size_t>>(1, 0);
+}
+
+Snapshot::Snapshot() : pieces(EMPTY_PIECES), line_starts(EMPTY_LINE_STARTS) {}
+
+uint64_t Snapshot::getVersion() const { return version; }
+
+size_t Snapshot::getTotalLength() const { return total_length; }
+
+size_t Snapshot::getLineCount() const { return line_starts->size(); }
+
+size_t Snapshot::lineStart(size_t row) const {
+    return (*line_starts)[row] + (row >= pending_row ? pending_delta : 0);
+}
+
+size_t Snapshot::getLineStart(size_t row) const {
+    if (row >= line_starts->size()) {
+        return total_length;
+    }
+    return lineStart(row);
+}
+
+size_t Snapshot::getLineLength(size_t row) const {
+    if (row >= line_starts->size()) {
+        return 0;
+    }
+    if (row + 1 < line_starts->size()) {
+        return lineStart(row + 1) - lineStart(row) - 1;
+    }
+    return total_length - lineStart(row);
+}
+
+size_t Snapshot::getLineFromIndex(size_t index) const {
+    size_t low = 0, high = line_starts->size();
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (lineStart(mid) <= index) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low - 1;
+}
+
+std::string Snapshot::getText() const { return getText(0, total_length); }
+
+std::string Snapshot::getText(size_t index, size_t length) const {
+    std::string text;
+    if (index >= total_length || length == 0) {
+        return text;
+    }
+    length = std::min(length, total_length - index);
+    text.reserve(length);
+
+    size_t curr_length = 0;
+    for (const auto &p : *pieces) {
+        if (curr_length + p.length > index) {
+            size_t piece_offset = index - curr_length;
+            size_t take = std::min(p.length - piece_offset, length);
+            const char *data = p.source == BufType::ORIGINAL ? original_data : add_data;
+            text.append(data + p.start + piece_offset, take);
+            index += take;
+            length -= take;
+            if (length == 0) {
+                break;
+            }
+        }
+        curr_length += p.length;
+    }
+    return text;
+}
+
+std::string Snapshot::getLine(size_t row) const { return getText(getLineStart(row), getLineLength(row)); }
+
+TextIterator Snapshot::iteratorAt(size_t index) const { return TextIterator(*pieces, original_data, add_data, index); }
+
+std::optional<char> Snapshot::getCharacter(size_t index) const {
+    if (index >= total_length) {
+        return std::nullopt;
+    }
+    size_t curr_length = 0;
+    for (const auto &p : *pieces) {
+        if (curr_length + p.length > index) {
+            const char *data = p.source == BufType::ORIGINAL ? original_data : add_data;
+            return data[p.start + index - curr_length];
+        }
+        curr_length += p.length;
+    }
+    return std::nullopt;
+}
+}
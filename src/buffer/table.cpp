@@ -1,14 +1,49 @@
+#include <algorithm>
+#include <atomic>
+#include <blip/buffer/iterator.hpp>
+#include <blip/buffer/snapshot.hpp>
 #include <blip/buffer/table.hpp>
 
 namespace buffer {
 
-PieceTable::PieceTable(const std::string &initial_text) : original_buffer(initial_text) {
+PieceTable::PieceTable(const std::string &initial_text)
+    : original_buffer(std::make_shared<const std::string>(initial_text)), add_buffer(std::make_shared<std::string>()),
+      pieces(std::make_shared<std::vector<Piece>>()) {
     if (!initial_text.empty()) {
-        pieces.push_back({BufType::ORIGINAL, 0, initial_text.length()});
+        mutablePieces().push_back({BufType::ORIGINAL, 0, initial_text.length()});
         total_length = initial_text.length();
     }
 }
 
+std::vector<Piece> &PieceTable::mutablePieces() {
+    if (pieces.use_count() > 1) {
+        pieces = std::make_shared<std::vector<Piece>>(*pieces);
+    } else {
+        // use_count is a relaxed read; pair it with the release of the last snapshot dropped on
+        // another thread so its reads finish before the writes that follow.
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    // Every piece list is allocated non-const by this class; the const is only for sharing.
+    return const_cast<std::vector<Piece> &>(*pieces);
+}
+
+size_t PieceTable::appendToAddBuffer(const std::string &text) {
+    size_t add_start = add_buffer->length();
+    // A snapshot may be reading the bytes already written, so never reallocate under it.
+    if (add_buffer.use_count() > 1 && add_start + text.length() > add_buffer->capacity()) {
+        auto grown = std::make_shared<std::string>();
+        grown->reserve(std::max(add_buffer->capacity() * 2, add_start + text.length()));
+        grown->append(*add_buffer);
+        add_buffer = std::move(grown);
+    }
+    add_buffer->append(text);
+    return add_start;
+}
+
+const std::string &PieceTable::bufferFor(BufType source) const {
+    return source == BufType::ORIGINAL ? *original_buffer : *add_buffer;
+}
+
 void PieceTable::insert(size_t index, const std::string &text) {
     if (text.empty())
         return;
@@ -17,8 +52,8 @@ void PieceTable::insert(size_t index, const std::string &text) {
         index = total_length;
     }
 
-    size_t add_start = add_buffer.length();
-    add_buffer += text;
+    size_t add_start = appendToAddBuffer(text);
+    auto &pieces = mutablePieces();
 
     if (pieces.empty()) {
         pieces.push_back(Piece{BufType::ADD, add_start, text.length()});
@@ -36,6 +71,8 @@ void PieceTable::insert(size_t index, const std::string &text) {
             } else if (pieces[i].source == BufType::ADD && pieces[i].start + pieces[i].length == add_start &&
                        piece_index == pieces[i].length) {
                 pieces[i].length += text.length();
+            } else if (piece_index == pieces[i].length) {
+                pieces.insert(pieces.begin() + i + 1, Piece{BufType::ADD, add_start, text.length()});
             } else {
                 Piece right_half = {pieces[i].source, pieces[i].start + piece_index, pieces[i].length - piece_index};
                 Piece new_piece = {BufType::ADD, add_start, text.length()};
@@ -52,49 +89,76 @@ void PieceTable::insert(size_t index, const std::string &text) {
 }
 
 void PieceTable::erase(size_t index, size_t length) {
-    if (length < 1)
-        return;
+    if (index > total_length)
+        index = total_length;
 
     if (length > index) {
         length = index;
     }
 
-    if (index > total_length)
-        index = total_length;
+    eraseRange(index - length, index);
+}
 
-    size_t curr_length = 0;
-    int i = 0;
+void PieceTable::eraseRange(size_t start, size_t end) {
+    end = std::min(end, total_length);
+    if (start >= end)
+        return;
+    splice(start, end, std::nullopt);
+}
 
-    for (; i < pieces.size(); i++) {
-        if (curr_length + pieces[i].length >= index)
-            break;
-        curr_length += pieces[i].length;
+void PieceTable::replace(size_t offset, size_t length, const std::string &text) {
+    offset = std::min(offset, total_length);
+    length = std::min(length, total_length - offset);
+    if (length == 0) {
+        insert(offset, text);
+        return;
+    }
+    if (text.empty()) {
+        splice(offset, offset + length, std::nullopt);
+        return;
     }
+    size_t add_start = appendToAddBuffer(text);
+    splice(offset, offset + length, Piece{BufType::ADD, add_start, text.length()});
+}
 
-    while (i >= 0 && length > 0) {
-        size_t chars_available = index - curr_length;
-        size_t delete_amount = std::min(length, chars_available);
-        if (delete_amount == pieces[i].length) {
-            pieces.erase(pieces.begin() + i);
-        } else if (chars_available == pieces[i].length) {
-            pieces[i].length -= delete_amount;
-        } else if (chars_available == delete_amount) {
-            pieces[i].start += delete_amount;
-            pieces[i].length -= delete_amount;
-        } else {
-            Piece right_part = {pieces[i].source, pieces[i].start + chars_available, pieces[i].length - chars_available};
-            pieces[i].length = chars_available - delete_amount;
-            pieces.insert(pieces.begin() + i + 1, right_part);
-        }
-        total_length -= delete_amount;
-        length -= delete_amount;
-        index -= delete_amount;
-        if (length == 0)
-            break;
-        if (--i >= 0) {
-            curr_length -= pieces[i].length;
-        }
+// Swaps the pieces covering [start, end) for at most a left remnant, the inserted piece and a
+// right remnant, moving the tail of the piece list once however many pieces the range spans.
+void PieceTable::splice(size_t start, size_t end, std::optional<Piece> inserted) {
+    auto &pieces = mutablePieces();
+    size_t first = 0;
+    size_t first_offset = 0;
+    while (first_offset + pieces[first].length <= start) {
+        first_offset += pieces[first].length;
+        first++;
+    }
+    size_t last = first;
+    size_t last_offset = first_offset;
+    while (last_offset + pieces[last].length < end) {
+        last_offset += pieces[last].length;
+        last++;
+    }
+
+    Piece replacement[3];
+    size_t count = 0;
+    if (start > first_offset) {
+        replacement[count++] = Piece{pieces[first].source, pieces[first].start, start - first_offset};
+    }
+    if (inserted) {
+        replacement[count++] = *inserted;
+    }
+    size_t cut = end - last_offset;
+    if (cut < pieces[last].length) {
+        replacement[count++] = Piece{pieces[last].source, pieces[last].start + cut, pieces[last].length - cut};
+    }
+
+    size_t covered = last - first + 1;
+    std::copy(replacement, replacement + std::min(count, covered), pieces.begin() + first);
+    if (count < covered) {
+        pieces.erase(pieces.begin() + first + count, pieces.begin() + first + covered);
+    } else if (count > covered) {
+        pieces.insert(pieces.begin() + first + covered, replacement + covered, replacement + count);
     }
+    total_length = total_length - (end - start) + (inserted ? inserted->length : 0);
 }
 
 size_t PieceTable::getTotalLength() const { return total_length; }
@@ -102,27 +166,42 @@ size_t PieceTable::getTotalLength() const { return total_length; }
 std::string PieceTable::getText() const {
     std::string final_text;
     final_text.reserve(total_length);
-    for (const auto &p : pieces) {
-        if (p.source == BufType::ORIGINAL) {
-            final_text += original_buffer.substr(p.start, p.length);
-        } else {
-            final_text += add_buffer.substr(p.start, p.length);
-        }
+    for (const auto &p : *pieces) {
+        final_text.append(bufferFor(p.source), p.start, p.length);
     }
     return final_text;
 }
 
-size_t PieceTable::getPieceCount() const { return pieces.size(); }
+size_t PieceTable::getPieceCount() const { return pieces->size(); }
+
+size_t PieceTable::getMemoryUsage() const {
+    return original_buffer->capacity() + add_buffer->capacity() + pieces->capacity() * sizeof(Piece);
+}
+
+TextIterator PieceTable::iteratorAt(size_t index) const {
+    return TextIterator(*pieces, original_buffer->data(), add_buffer->data(), index);
+}
 
 PieceTable::State PieceTable::getState() const { return State{pieces, total_length}; }
 
+Snapshot PieceTable::snapshot() const {
+    Snapshot snap;
+    snap.original_buffer = original_buffer;
+    snap.add_buffer = add_buffer;
+    snap.original_data = original_buffer->data();
+    snap.add_data = add_buffer->data();
+    snap.pieces = pieces;
+    snap.total_length = total_length;
+    return snap;
+}
+
 void PieceTable::restoreState(const State &state) {
     this->pieces = state.pieces;
     this->total_length = state.total_length;
 }
 
 std::optional<char> PieceTable::getCharacterFromCursor(size_t index, int offset) const {
-    if (total_length == 0 || pieces.empty())
+    if (total_length == 0 || pieces->empty())
         return std::nullopt;
 
     size_t target_index;
@@ -141,15 +220,10 @@ std::optional<char> PieceTable::getCharacterFromCursor(size_t index, int offset)
     }
 
     size_t curr_length = 0;
-    for (const auto &p : pieces) {
+    for (const auto &p : *pieces) {
         if (curr_length + p.length > target_index) {
             size_t piece_offset = target_index - curr_length;
-            if (p.source == BufType::ORIGINAL) {
-                return original_buffer[p.start + piece_offset];
-            } else {
-                return add_buffer[p.start + piece_offset];
-            }
-            break;
+            return bufferFor(p.source)[p.start + piece_offset];
         }
         curr_length += p.length;
     }
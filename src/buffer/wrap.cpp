@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <blip/buffer/iterator.hpp>
+#include <blip/buffer/wrap.hpp>
+
+namespace buffer {
+
+void WrapIndex::configure(size_t new_width, size_t new_tab_width, size_t line_count) {
+    new_tab_width = std::max<size_t>(1, new_tab_width);
+    if (new_width == 0) {
+        width = 0;
+        chunks.clear();
+        tree.clear();
+        return;
+    }
+    bool was_enabled = isEnabled();
+    if (was_enabled && new_width == width && new_tab_width == tab_width) {
+        return;
+    }
+    width = new_width;
+    tab_width = new_tab_width;
+    if (!was_enabled) {
+        invalidate(line_count);
+        return;
+    }
+    // The old counts stay as estimates, so a resize costs nothing until lines come into view.
+    generation++;
+    sweep = 0;
+}
+
+bool WrapIndex::isEnabled() const { return width > 0; }
+
+size_t WrapIndex::getWidth() const { return width; }
+
+void WrapIndex::invalidate(size_t line_count) {
+    if (!isEnabled()) {
+        return;
+    }
+    chunks.clear();
+    for (size_t first = 0; first < line_count; first += WRAP_CHUNK_LINES) {
+        size_t lines = std::min(WRAP_CHUNK_LINES, line_count - first);
+        chunks.push_back({std::vector<uint32_t>(lines, 1), std::vector<uint32_t>(lines, 0)});
+    }
+    rebuildTree();
+    sweep = 0;
+}
+
+void WrapIndex::onInsert(size_t row, size_t new_lines) {
+    if (!isEnabled()) {
+        return;
+    }
+    auto [c, local] = find(LINES, row);
+    Chunk &chunk = chunks[c];
+    chunk.stamps[local] = 0;
+    if (new_lines == 0) {
+        return;
+    }
+    chunk.rows.insert(chunk.rows.begin() + local + 1, new_lines, 1);
+    chunk.stamps.insert(chunk.stamps.begin() + local + 1, new_lines, 0);
+    add(c, new_lines, new_lines);
+    if (chunk.rows.size() > 2 * WRAP_CHUNK_LINES) {
+        split(c);
+    }
+    if (sweep > row) {
+        sweep += new_lines;
+    }
+}
+
+void WrapIndex::onErase(size_t row, size_t removed_lines) {
+    if (!isEnabled()) {
+        return;
+    }
+    auto [c, local] = find(LINES, row);
+    chunks[c].stamps[local] = 0;
+    size_t remaining = removed_lines, at = local + 1;
+    bool emptied = false;
+    while (remaining > 0) {
+        if (at >= chunks[c].rows.size()) {
+            c++;
+            at = 0;
+            continue;
+        }
+        Chunk &chunk = chunks[c];
+        size_t take = std::min(remaining, chunk.rows.size() - at);
+        int64_t rows = 0;
+        for (size_t i = at; i < at + take; i++) {
+            rows += chunk.rows[i];
+        }
+        chunk.rows.erase(chunk.rows.begin() + at, chunk.rows.begin() + at + take);
+        chunk.stamps.erase(chunk.stamps.begin() + at, chunk.stamps.begin() + at + take);
+        add(c, -(int64_t)take, -rows);
+        emptied = emptied || chunk.rows.empty();
+        remaining -= take;
+    }
+    if (emptied) {
+        chunks.erase(std::remove_if(chunks.begin(), chunks.end(), [](const Chunk &chunk) { return chunk.rows.empty(); }),
+                     chunks.end());
+        rebuildTree();
+    }
+    if (sweep > row + removed_lines) {
+        sweep -= removed_lines;
+    } else if (sweep > row) {
+        sweep = row + 1;
+    }
+}
+
+bool WrapIndex::isMeasured(size_t row) const {
+    if (!isEnabled()) {
+        return true;
+    }
+    auto [c, local] = find(LINES, row);
+    return chunks[c].stamps[local] == generation;
+}
+
+std::pair<size_t, bool> WrapIndex::measure(const PieceTable &table, size_t row, size_t start, size_t end) {
+    if (!isEnabled()) {
+        return {1, false};
+    }
+    auto [c, local] = find(LINES, row);
+    Chunk &chunk = chunks[c];
+    if (chunk.stamps[local] == generation) {
+        return {chunk.rows[local], false};
+    }
+    uint32_t rows = (uint32_t)std::min<size_t>(count(table, start, end, SIZE_MAX, nullptr), UINT32_MAX);
+    bool changed = rows != chunk.rows[local];
+    add(c, 0, (int64_t)rows - (int64_t)chunk.rows[local]);
+    chunk.rows[local] = rows;
+    chunk.stamps[local] = generation;
+    return {rows, changed};
+}
+
+size_t WrapIndex::subRowOf(const PieceTable &table, size_t start, size_t end, size_t index) const {
+    if (!isEnabled()) {
+        return 0;
+    }
+    size_t sub_row = 0;
+    count(table, start, end, index, &sub_row);
+    return sub_row;
+}
+
+size_t WrapIndex::getVisualRow(size_t row) const {
+    if (!isEnabled()) {
+        return row;
+    }
+    if (row >= prefix(LINES, chunks.size())) {
+        return getRowCount();
+    }
+    auto [c, local] = find(LINES, row);
+    size_t visual = prefix(ROWS, c);
+    for (size_t i = 0; i < local; i++) {
+        visual += chunks[c].rows[i];
+    }
+    return visual;
+}
+
+std::pair<size_t, size_t> WrapIndex::locate(size_t visual_row) const {
+    if (!isEnabled()) {
+        return {visual_row, 0};
+    }
+    size_t total = getRowCount();
+    if (visual_row >= total) {
+        const Chunk &last = chunks.back();
+        return {prefix(LINES, chunks.size()) - 1, last.rows.back() - 1};
+    }
+    auto [c, remainder] = find(ROWS, visual_row);
+    const Chunk &chunk = chunks[c];
+    size_t local = 0;
+    while (remainder >= chunk.rows[local]) {
+        remainder -= chunk.rows[local++];
+    }
+    return {prefix(LINES, c) + local, remainder};
+}
+
+size_t WrapIndex::getRowCount() const { return isEnabled() ? prefix(ROWS, chunks.size()) : 0; }
+
+size_t WrapIndex::nextUnmeasured() {
+    if (!isEnabled()) {
+        return SIZE_MAX;
+    }
+    size_t line_count = prefix(LINES, chunks.size());
+    while (sweep < line_count) {
+        auto [c, local] = find(LINES, sweep);
+        const Chunk &chunk = chunks[c];
+        for (; local < chunk.rows.size(); local++, sweep++) {
+            if (chunk.stamps[local] != generation) {
+                return sweep;
+            }
+        }
+    }
+    return SIZE_MAX;
+}
+
+// Streams the line through the same decoder and wrap as the typesetter. With a stop index, also
+// reports the row that holds it, and stops reading once that row has closed.
+size_t WrapIndex::count(const PieceTable &table, size_t start, size_t end, size_t stop, size_t *sub_row) const {
+    Utf8Decoder decoder;
+    WordWrap wrap(width);
+    size_t index = start, characters = 0, column = 0, breaks = 0, target = SIZE_MAX;
+    bool closed = false;
+    auto emit = [&](uint32_t codepoint, size_t at) {
+        if (at >= stop && target == SIZE_MAX) {
+            target = characters;
+        }
+        size_t cells = codepoint == '\t' ? tab_width - column % tab_width : 1;
+        column += cells;
+        wrap.feed(characters++, cells, codepoint == ' ' || codepoint == '\t', [&](size_t position) {
+            if (position <= target) {
+                breaks++;
+            } else {
+                closed = true;
+            }
+        });
+    };
+    table.iteratorAt(start).skipForward([&](char c) {
+        if (index >= end || closed) {
+            return false;
+        }
+        decoder.push(index++, (unsigned char)c, emit);
+        return true;
+    });
+    decoder.finish(emit);
+    if (sub_row) {
+        *sub_row = breaks;
+    }
+    return breaks + 1;
+}
+
+// Fenwick descent: the chunk holding the target-th line or row, and the target's offset in it.
+std::pair<size_t, size_t> WrapIndex::find(int kind, uint64_t target) const {
+    size_t n = chunks.size(), pos = 0, step = 1;
+    while (step * 2 <= n) {
+        step *= 2;
+    }
+    for (; step > 0; step /= 2) {
+        if (pos + step <= n && tree[pos + step][kind] <= target) {
+            pos += step;
+            target -= tree[pos][kind];
+        }
+    }
+    return {std::min(pos, n - 1), target};
+}
+
+uint64_t WrapIndex::prefix(int kind, size_t chunk) const {
+    uint64_t sum = 0;
+    for (size_t i = chunk; i > 0; i -= i & -i) {
+        sum += tree[i][kind];
+    }
+    return sum;
+}
+
+void WrapIndex::add(size_t chunk, int64_t lines, int64_t rows) {
+    for (size_t i = chunk + 1; i < tree.size(); i += i & -i) {
+        tree[i][LINES] += (uint64_t)lines;
+        tree[i][ROWS] += (uint64_t)rows;
+    }
+}
+
+void WrapIndex::rebuildTree() {
+    tree.assign(chunks.size() + 1, {0, 0});
+    for (size_t i = 0; i < chunks.size(); i++) {
+        tree[i + 1][LINES] = chunks[i].rows.size();
+        for (uint32_t rows : chunks[i].rows) {
+            tree[i + 1][ROWS] += rows;
+        }
+    }
+    for (size_t i = 1; i < tree.size(); i++) {
+        size_t parent = i + (i & -i);
+        if (parent < tree.size()) {
+            tree[parent][LINES] += tree[i][LINES];
+            tree[parent][ROWS] += tree[i][ROWS];
+        }
+    }
+}
+
+void WrapIndex::split(size_t c) {
+    Chunk whole = std::move(chunks[c]);
+    std::vector<Chunk> parts;
+    for (size_t first = 0; first < whole.rows.size(); first += WRAP_CHUNK_LINES) {
+        size_t last = std::min(first + WRAP_CHUNK_LINES, whole.rows.size());
+        parts.push_back({std::vector<uint32_t>(whole.rows.begin() + first, whole.rows.begin() + last),
+                         std::vector<uint32_t>(whole.stamps.begin() + first, whole.stamps.begin() + last)});
+    }
+    chunks.erase(chunks.begin() + c);
+    chunks.insert(chunks.begin() + c, std::make_move_iterator(parts.begin()), std::make_move_iterator(parts.end()));
+    rebuildTree();
+}
+}
@@ -320,7 +320,7 @@ void handlePreferenceConfigUpdates(std::string key, std::string value, EditorCon
     // Preference Config Update
     if (key == constants::preference::TAB_WIDTH) {
         int width;
-        if (!parseNum(value, width)) {
+        if (parseNum(value, width)) {
             state.preference.tab_width = width <= 2 ? defaults::preference::TAB_WIDTH : width;
         } else {
             state.preference.tab_width = defaults::preference::TAB_WIDTH;
@@ -1,25 +1,149 @@
 #include <blip/config/editor.hpp>
 #include <blip/core/log.hpp>
-#include <iostream>
 #include <string>
 #include <type_traits>
 
 namespace core {
+namespace {
+constexpr const char *LEVEL_NAMES[] = {"TRACE", "DEBUG", "INFO ", "WARN ", "ERROR"};
+constexpr const char *CATEGORY_NAMES[] = {"app", "buffer", "config", "platform", "text", "ui"};
+// How long the drainer sleeps when the ring is empty; records wait at most this long.
+constexpr auto DRAIN_INTERVAL = std::chrono::milliseconds(10);
+}
+
+Logger &Logger::get() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger() : started(std::chrono::steady_clock::now()) {
+    for (size_t i = 0; i < CAPACITY; i++) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    output.reserve(CAPACITY * 64);
+    drainer = std::thread(&Logger::loop, this);
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wake.notify_one();
+    drainer.join();
+}
+
+// A slot is free for the producer whose position matches its sequence; the first to move head
+// past it owns it. A slot still holding an unwritten record means the ring is full.
+Logger::Slot *Logger::claim() {
+    size_t position = head.load(std::memory_order_relaxed);
+    while (true) {
+        Slot &slot = slots[position % CAPACITY];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+        if (difference == 0) {
+            if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                return &slot;
+            }
+        } else if (difference < 0) {
+            return nullptr;
+        } else {
+            position = head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// The drainer wakes on its own every DRAIN_INTERVAL; a burst that fills half the ring before then
+// nudges it early.
+void Logger::publish(Slot *slot) {
+    size_t position = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(position + 1, std::memory_order_release);
+    if ((position + 1) % (CAPACITY / 2) == 0) {
+        wake.notify_one();
+    }
+}
+
+void Logger::flush() {
+    uint64_t target = head.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(mutex);
+    wake.notify_one();
+    drained.wait(lock, [&]() { return written.load(std::memory_order_acquire) >= target || !running; });
+}
+
+uint64_t Logger::getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+void Logger::loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        lock.unlock();
+        size_t count = drain();
+        lock.lock();
+        if (count > 0) {
+            drained.notify_all();
+        }
+        if (!running) {
+            break;
+        }
+        if (count == 0) {
+            wake.wait_for(lock, DRAIN_INTERVAL);
+        }
+    }
+    lock.unlock();
+    drain();
+    drained.notify_all();
+}
+
+// Only this thread reads the ring, so tail needs no synchronization.
+size_t Logger::drain() {
+    size_t count = 0;
+    output.clear();
+    while (true) {
+        Slot &slot = slots[tail % CAPACITY];
+        if (slot.sequence.load(std::memory_order_acquire) != tail + 1) {
+            break;
+        }
+        const Record &record = slot.record;
+        char stamp[32];
+        auto millis = std::chrono::duration_cast<std::chrono::microseconds>(record.time - started).count() / 1000.0;
+        std::snprintf(stamp, sizeof(stamp), "[%10.3f] ", millis);
+        output += stamp;
+        output += LEVEL_NAMES[(size_t)record.level];
+        output += ' ';
+        output += CATEGORY_NAMES[(size_t)record.category];
+        output += ": ";
+        output.append(record.text, record.length);
+        output += '\n';
+        slot.sequence.store(tail + CAPACITY, std::memory_order_release);
+        tail++;
+        count++;
+    }
+    uint64_t lost = dropped.load(std::memory_order_relaxed);
+    if (lost != reported_dropped) {
+        output += "[dropped " + std::to_string(lost - reported_dropped) + " log records]\n";
+        reported_dropped = lost;
+    }
+    if (!output.empty()) {
+        std::fwrite(output.data(), 1, output.size(), stdout);
+        std::fflush(stdout);
+        written.fetch_add(count, std::memory_order_release);
+    }
+    return count;
+}
+
 template <typename T> void printVal(T value, const char *str) {
     if constexpr (std::is_same_v<T, config::Color>) {
-        printf("    %s = rgba(%u,%u,%u,%u)\n", str, value.r, value.g, value.b, value.a);
-    } else if constexpr (std::is_same_v<Uint8, T> || std::is_same_v<Uint16, T>) {
-        printf("    %s = %u\n", str, value);
+        BLIP_LOG(DEBUG, CONFIG, "    ", str, " = rgba(", value.r, ",", value.g, ",", value.b, ",", value.a, ")");
     } else if constexpr (std::is_same_v<config::Shortcut, T>) {
-        printf("    %s = (mods: %u, keys: %d)\n", str, value.modifiers, value.key);
+        BLIP_LOG(DEBUG, CONFIG, "    ", str, " = (mods: ", value.modifiers, ", keys: ", value.key, ")");
     } else if constexpr (std::is_same_v<T, bool> || std::is_same_v<T, std::string> || std::is_same_v<T, char *> ||
-                         std::is_same_v<T, Uint8> || std::is_same_v<T, int> || std::is_same_v<T, float>) {
-        std::cout << "    " << str << " = " << value << std::endl;
+                         std::is_same_v<T, Uint8> || std::is_same_v<T, Uint16> || std::is_same_v<T, int> ||
+                         std::is_same_v<T, float>) {
+        BLIP_LOG(DEBUG, CONFIG, "    ", str, " = ", value);
     }
 }
 
 void printState(config::EditorConfig &state) {
-    std::cout << "[Theme]" << std::endl;
+    BLIP_LOG(DEBUG, CONFIG, "[Theme]");
     printVal(state.theme.background, config::constants::theme::BACKGROUND);
     printVal(state.theme.foreground, config::constants::theme::FOREGROUND);
     printVal(state.theme.cursor, config::constants::theme::CURSOR);
@@ -37,14 +161,14 @@ void printState(config::EditorConfig &state) {
     printVal(state.theme.completion_background, config::constants::theme::COMPLETION_BACKGROUND);
     printVal(state.theme.hover_tab_background, config::constants::theme::HOVER_TAB_BACKGROUND);
 
-    std::cout << "[Font]" << std::endl;
+    BLIP_LOG(DEBUG, CONFIG, "[Font]");
     printVal(state.font.color, config::constants::font::COLOR);
     printVal(state.font.family, config::constants::font::FAMILY);
     printVal(state.font.ligatures, config::constants::font::LIGATURES);
     printVal(state.font.size, config::constants::font::SIZE);
     printVal(state.font.line_height, config::constants::font::LINE_HEIGHT);
 
-    std::cout << "[UI]" << std::endl;
+    BLIP_LOG(DEBUG, CONFIG, "[UI]");
     printVal(state.ui.cursor_style, config::constants::ui::CURSOR_STYLE);
     printVal(state.ui.line_numbers, config::constants::ui::LINE_NUMBERS);
     printVal(state.ui.status_bar_visible, config::constants::ui::STATUS_BAR_VISIBLE);
@@ -54,7 +178,7 @@ void printState(config::EditorConfig &state) {
     printVal(state.ui.show_indent_guides, config::constants::ui::SHOW_INDENT_GUIDES);
     printVal(state.ui.ui_scale, config::constants::ui::UI_SCALE);
 
-    std::cout << "[Preference]" << std::endl;
+    BLIP_LOG(DEBUG, CONFIG, "[Preference]");
     printVal(state.preference.tab_width, config::constants::preference::TAB_WIDTH);
     printVal(state.preference.auto_format, config::constants::preference::AUTO_FORMAT);
     printVal(state.preference.bracket_matching, config::constants::preference::BRACKET_MATCHING);
@@ -64,7 +188,7 @@ void printState(config::EditorConfig &state) {
     printVal(state.preference.highlight_active_scope, config::constants::preference::HIGHLIGHT_ACTIVE_SCOPE);
     printVal(state.preference.auto_indent, config::constants::preference::AUTO_INDENT);
 
-    std::cout << "[Input]" << std::endl;
+    BLIP_LOG(DEBUG, CONFIG, "[Input]");
     printVal(state.input.shortcut_save, config::constants::input::SHORTCUT_SAVE);
     printVal(state.input.shortcut_search, config::constants::input::SHORTCUT_SEARCH);
     printVal(state.input.shortcut_split_horizontal, config::constants::input::SHORTCUT_SPLIT_HORIZONTAL);
@@ -75,7 +199,7 @@ void printState(config::EditorConfig &state) {
     printVal(state.input.mouse_selection, config::constants::input::MOUSE_SELECTION);
     printVal(state.input.drag_and_drop, config::constants::input::DRAG_AND_DROP);
 
-    std::cout << "[Plugins]" << std::endl;
+    BLIP_LOG(DEBUG, CONFIG, "[Plugins]");
     printVal(state.plugins.lsp, config::constants::plugins::LSP);
     printVal(state.plugins.snippets, config::constants::plugins::SNIPPETS);
     printVal(state.plugins.git, config::constants::plugins::GIT);
@@ -83,10 +207,8 @@ void printState(config::EditorConfig &state) {
     printVal(state.plugins.file_explorer, config::constants::plugins::FILE_EXPLORER);
     printVal(state.plugins.hot_reload, config::constants::plugins::HOT_RELOAD);
 
-    std::cout << "[File]" << std::endl;
+    BLIP_LOG(DEBUG, CONFIG, "[File]");
     printVal(state.file.autosave_mode, config::constants::file::AUTOSAVE_MODE);
     printVal(state.file.show_hidden_files, config::constants::file::SHOW_HIDDEN_FILES);
-
-    std::cout << "\n\n";
 }
 }
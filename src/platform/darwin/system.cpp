@@ -1,10 +1,12 @@
 #include <blip/platform/system.hpp>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <sys/resource.h>
 
 namespace platform {
-std::string getTTFPath(std::string &family, std::string &style) {
+std::string getTTFPath(const std::string &family, const std::string &style) {
     std::string file = "";
     for (const auto c : family) {
         if (c != ' ') {
@@ -20,6 +22,12 @@ std::string getTTFPath(std::string &family, std::string &style) {
     return ttf_path;
 }
 
+// Without fontconfig the one font known to cover most of Unicode is the whole chain.
+std::string getFallbackPath(uint32_t) {
+    std::string ttf_path = "/Library/Fonts/Arial Unicode.ttf";
+    return std::filesystem::exists(ttf_path) ? ttf_path : "";
+}
+
 void readFile(const char *fname, std::string &lines) {
     std::string filename{fname};
     std::fstream f{filename};
@@ -34,4 +42,18 @@ void readFile(const char *fname, std::string &lines) {
         lines += line + "\n";
     }
 }
+
+std::string getCacheDir() {
+    const char *home = std::getenv("HOME");
+    return std::string(home ? home : ".") + "/Library/Caches/blip";
+}
+
+size_t getPeakMemory() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    // macOS reports bytes.
+    return (size_t)usage.ru_maxrss;
+}
 }
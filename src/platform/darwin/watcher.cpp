@@ -10,12 +10,13 @@ namespace platform {
 ConfigWatcher::ConfigWatcher() : running(false), fileDirty(false) {}
 ConfigWatcher::~ConfigWatcher() { stop(); }
 
-void ConfigWatcher::start(const std::string &path, OnChangeCallback callback) {
+void ConfigWatcher::start(const std::string &path, OnChangeCallback callback, WakeCallback on_wake) {
     if (running) {
         stop();
     }
     filepath = path;
     action = callback;
+    wake = on_wake;
     running = true;
     fileDirty = false;
 
@@ -29,13 +30,15 @@ void ConfigWatcher::stop() {
     }
 }
 
-void ConfigWatcher::check() {
-    if (fileDirty) {
-        fileDirty = false;
-        if (action) {
-            action();
-        }
+bool ConfigWatcher::check() {
+    if (!fileDirty) {
+        return false;
+    }
+    fileDirty = false;
+    if (action) {
+        action();
     }
+    return true;
 }
 
 void ConfigWatcher::loop() {
@@ -62,6 +65,9 @@ void ConfigWatcher::loop() {
         if (n > 0) {
             if (event.fflags & (NOTE_WRITE | NOTE_RENAME)) {
                 fileDirty = true;
+                if (wake) {
+                    wake();
+                }
                 if (event.fflags & NOTE_RENAME) {
                     close(fd);
                     continue;
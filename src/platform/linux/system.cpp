@@ -1,9 +1,22 @@
 #include <blip/platform/system.hpp>
+#include <cstdlib>
 #include <fontconfig/fontconfig.h>
 #include <fstream>
 #include <iostream>
+#include <sys/resource.h>
 
 namespace platform {
+namespace {
+// Both font lookups may run on different threads; the static makes FcInit happen exactly once.
+bool initFontconfig() {
+    static const bool initialized = FcInit();
+    if (!initialized) {
+        std::cerr << "Could not init fontconfig\n";
+    }
+    return initialized;
+}
+}
+
 void readFile(const char *fname, std::string &lines) {
     std::string filename{fname};
     std::fstream f{filename};
@@ -20,13 +33,8 @@ void readFile(const char *fname, std::string &lines) {
 }
 
 std::string getTTFPath(const std::string &family, const std::string &style) {
-    static bool initialized = false;
-    if (!initialized) {
-        if (!FcInit()) {
-            std::cerr << "Could not init fontconfig\n";
-            return "";
-        }
-        initialized = true;
+    if (!initFontconfig()) {
+        return "";
     }
 
     std::string patternStr = family;
@@ -78,4 +86,55 @@ std::string getTTFPath(const std::string &family, const std::string &style) {
 
     return path;
 }
+
+std::string getFallbackPath(uint32_t codepoint) {
+    if (!initFontconfig()) {
+        return "";
+    }
+
+    FcPattern *pat = FcPatternCreate();
+    FcCharSet *charset = FcCharSetCreate();
+    FcCharSetAddChar(charset, codepoint);
+    FcPatternAddCharSet(pat, FC_CHARSET, charset);
+    FcPatternAddString(pat, FC_FAMILY, (const FcChar8 *)"monospace");
+    FcConfigSubstitute(nullptr, pat, FcMatchPattern);
+    FcDefaultSubstitute(pat);
+
+    FcResult result;
+    FcPattern *font = FcFontMatch(nullptr, pat, &result);
+
+    // The best match is not guaranteed to cover the codepoint, so check its charset too.
+    std::string path;
+    if (font) {
+        FcChar8 *file = nullptr;
+        FcCharSet *covered = nullptr;
+        if (FcPatternGetCharSet(font, FC_CHARSET, 0, &covered) == FcResultMatch && FcCharSetHasChar(covered, codepoint) &&
+            FcPatternGetString(font, FC_FILE, 0, &file) == FcResultMatch) {
+            path = reinterpret_cast<char *>(file);
+        }
+        FcPatternDestroy(font);
+    }
+
+    FcCharSetDestroy(charset);
+    FcPatternDestroy(pat);
+    return path;
+}
+
+std::string getCacheDir() {
+    const char *cache = std::getenv("XDG_CACHE_HOME");
+    if (cache && *cache) {
+        return std::string(cache) + "/blip";
+    }
+    const char *home = std::getenv("HOME");
+    return std::string(home ? home : ".") + "/.cache/blip";
+}
+
+size_t getPeakMemory() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    // Linux reports kilobytes.
+    return (size_t)usage.ru_maxrss * 1024;
+}
 }
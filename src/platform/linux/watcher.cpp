@@ -8,7 +8,7 @@ namespace platform {
 ConfigWatcher::ConfigWatcher() : running(false), fileDirty(false) {}
 ConfigWatcher::~ConfigWatcher() { stop(); }
 
-void ConfigWatcher::start(const std::string &path, OnChangeCallback callback) {
+void ConfigWatcher::start(const std::string &path, OnChangeCallback callback, WakeCallback on_wake) {
     if (running) {
         stop();
     }
@@ -17,6 +17,7 @@ void ConfigWatcher::start(const std::string &path, OnChangeCallback callback) {
     }
     filepath = path;
     action = callback;
+    wake = on_wake;
     running = true;
     fileDirty = false;
 
@@ -30,13 +31,15 @@ void ConfigWatcher::stop() {
     }
 }
 
-void ConfigWatcher::check() {
-    if (fileDirty) {
-        fileDirty = false;
-        if (action) {
-            action();
-        }
+bool ConfigWatcher::check() {
+    if (!fileDirty) {
+        return false;
+    }
+    fileDirty = false;
+    if (action) {
+        action();
     }
+    return true;
 }
 
 void ConfigWatcher::loop() {
@@ -83,6 +86,9 @@ void ConfigWatcher::loop() {
 
                 if (event->mask & (IN_MODIFY | IN_MOVE_SELF)) {
                     fileDirty = true;
+                    if (wake) {
+                        wake();
+                    }
                 }
 
                 if (event->mask & IN_IGNORED) {
@@ -1,7 +1,11 @@
 #pragma once
 #include <blip/buffer/buffer.hpp>
+#include <blip/buffer/manager.hpp>
 #include <cassert>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 
 void test_initialization() {
     std::cout << "Running test_initialization... ";
@@ -159,3 +163,495 @@ void test_get_character_from_cursor() {
 
     std::cout << "PASSED" << std::endl;
 }
+
+void test_snapshot_isolation() {
+    std::cout << "Running test_snapshot_isolation...";
+
+    buffer::EditorBuffer buffer("one\ntwo\n");
+    buffer::Snapshot before = buffer.snapshot();
+
+    buffer.setCursor(4);
+    buffer.insertText("middle\n");
+    buffer::Snapshot after = buffer.snapshot();
+
+    assert(before.getText() == "one\ntwo\n");
+    assert(before.getLineCount() == 3);
+    assert(before.getLine(1) == "two");
+    assert(after.getText() == "one\nmiddle\ntwo\n");
+    assert(after.getLineCount() == 4);
+    assert(after.getLine(1) == "middle");
+    assert(after.getText(4, 6) == "middle");
+    assert(after.getCharacter(4) == 'm');
+    assert(after.getLineFromIndex(11) == 2);
+    assert(after.getVersion() > before.getVersion());
+
+    buffer.undo();
+    assert(buffer.getText() == "one\ntwo\n");
+    assert(after.getText() == "one\nmiddle\ntwo\n");
+
+    std::cout << "PASSED" << std::endl;
+}
+
+void test_snapshot_pending_shift() {
+    std::cout << "Running test_snapshot_pending_shift...";
+
+    buffer::EditorBuffer buffer("a\nb\nc\nd\ne\n");
+    buffer.setCursor(2);
+    buffer.insertText("xy");
+    // The rows below the edit have not been shifted yet; the snapshot must see them shifted.
+    buffer::Snapshot first = buffer.snapshot();
+    assert(first.getLine(1) == "xyb");
+    assert(first.getLine(4) == "e");
+    assert(first.getLineStart(4) == 10);
+    assert(first.getLineLength(3) == 1);
+    assert(first.getLineFromIndex(10) == 4);
+    assert(first.getLineFromIndex(3) == 1);
+
+    buffer.setCursor(9);
+    buffer.insertText("\n");
+    buffer.setCursor(0);
+    buffer.insertText("zz");
+    assert(buffer.snapshot().getLine(4) == "");
+    assert(buffer.snapshot().getLine(5) == "e");
+    assert(first.getLineCount() == 6);
+    assert(first.getLine(3) == "d");
+    assert(first.getLineStart(4) == 10);
+
+    std::cout << "PASSED" << std::endl;
+}
+
+void test_manager_eviction() {
+    std::cout << "Running test_manager_eviction...";
+
+    auto dir = std::filesystem::temp_directory_path();
+    auto first = (dir / "blip_test_first.txt").string();
+    auto second = (dir / "blip_test_second.txt").string();
+    std::ofstream(first) << "first file\n";
+    std::ofstream(second) << "second file\n";
+
+    buffer::BufferManager buffers(1);
+    size_t first_id = buffers.open(first);
+    buffers.active().setCursor(5);
+
+    size_t second_id = buffers.open(second);
+    assert(buffers.getActiveId() == second_id);
+    assert(!buffers.isResident(first_id));
+    assert(buffers.active().getText() == "second file\n");
+
+    // A clean buffer is re-read from its file and keeps its cursor
+    buffer::EditorBuffer &restored = buffers.focus(first_id);
+    assert(restored.getText() == "first file\n");
+    assert(!restored.isModified());
+    assert(restored.getCursor() == 5);
+    assert(!buffers.isResident(second_id));
+
+    // An edited buffer stays resident over budget, so its history survives focusing away
+    restored.commit();
+    restored.insertText(" edited");
+    buffers.focus(second_id);
+    assert(buffers.isResident(first_id));
+    buffer::EditorBuffer &kept = buffers.focus(first_id);
+    assert(kept.getText() == "first edited file\n");
+    kept.undo();
+    assert(kept.getText() == "first file\n");
+
+    std::filesystem::remove(first);
+    std::filesystem::remove(second);
+    std::cout << "PASSED" << std::endl;
+}
+
+void test_manager_save() {
+    std::cout << "Running test_manager_save...";
+
+    auto path = (std::filesystem::temp_directory_path() / "blip_test_save.txt").string();
+    std::ofstream(path) << "saved\n";
+
+    buffer::BufferManager buffers;
+    size_t id = buffers.open(path);
+    buffers.active().insertText("un");
+    assert(buffers.active().isModified());
+    assert(buffers.save(id));
+    assert(!buffers.active().isModified());
+    std::ifstream in(path);
+    assert(std::string(std::istreambuf_iterator<char>(in), {}) == "unsaved\n");
+
+    buffers.open("");
+    assert(!buffers.save(buffers.getActiveId()));
+
+    std::filesystem::remove(path);
+    std::cout << "PASSED" << std::endl;
+}
+
+void test_word_motions() {
+    std::cout << "Running test_word_motions...";
+
+    buffer::EditorBuffer buffer("foo.bar baz\n\n  qux");
+    buffer.setCursor(0);
+    buffer.moveWordForward();
+    assert(buffer.getCursor() == 3);
+    buffer.moveWordForward(2);
+    assert(buffer.getCursor() == 8);
+    buffer.moveWordForward();
+    assert(buffer.getCursor() == 12);
+    buffer.moveWordForward();
+    assert(buffer.getCursor() == 15);
+    buffer.moveWordBackward(2);
+    assert(buffer.getCursor() == 8);
+    buffer.moveWordEnd();
+    assert(buffer.getCursor() == 10);
+
+    buffer.setCursor(0);
+    buffer.moveWordForward(1, true);
+    assert(buffer.getCursor() == 8);
+    buffer.moveWordEnd(1, true);
+    assert(buffer.getCursor() == 10);
+    buffer.moveWordBackward(1, true);
+    assert(buffer.getCursor() == 8);
+
+    // Motions scan across piece boundaries
+    buffer::EditorBuffer pieces("alpha");
+    pieces.setCursor(5);
+    pieces.insertText("beta gamma");
+    pieces.setCursor(2);
+    pieces.insertText("x");
+    pieces.setCursor(0);
+    pieces.moveWordForward();
+    assert(pieces.getCursor() == 11);
+    pieces.moveWordBackward();
+    assert(pieces.getCursor() == 0);
+
+    std::cout << "PASSED" << std::endl;
+}
+
+void test_text_objects() {
+    std::cout << "Running test_text_objects...";
+
+    buffer::EditorBuffer buffer("one two  three\nfour\n\nfive");
+    buffer.setCursor(5);
+    assert(buffer.getWordObject(false) == (std::pair<size_t, size_t>{4, 7}));
+    assert(buffer.getWordObject(true) == (std::pair<size_t, size_t>{4, 9}));
+    buffer.setCursor(11);
+    assert(buffer.getWordObject(true) == (std::pair<size_t, size_t>{7, 14}));
+
+    buffer.setCursor(16);
+    assert(buffer.getParagraphObject() == (std::pair<size_t, size_t>{0, 20}));
+    buffer.setCursor(21);
+    assert(buffer.getParagraphObject() == (std::pair<size_t, size_t>{21, 25}));
+
+    std::cout << "PASSED" << std::endl;
+}
+
+void test_bracket_matching() {
+    std::cout << "Running test_bracket_matching...";
+
+    buffer::EditorBuffer buffer("f(a[0], {b}) {}");
+    assert(buffer.findMatchingBracket(1) == 11);
+    assert(buffer.findMatchingBracket(11) == 1);
+    assert(buffer.findMatchingBracket(3) == 5);
+    assert(buffer.findMatchingBracket(0) == std::nullopt);
+    assert(buffer.findEnclosingScope(9) == (std::pair<size_t, size_t>{8, 10}));
+
+    // Matches far apart span many index chunks and survive edits in between
+    buffer.setCursor(14);
+    buffer.insertText(std::string(3 * buffer::BRACKET_CHUNK_SIZE, 'x') + "(" + std::string(10000, 'y') + ")");
+    size_t close = buffer.getTotalLength() - 1;
+    assert(buffer.findMatchingBracket(13) == close);
+    assert(buffer.findMatchingBracket(close) == 13);
+    assert(buffer.findMatchingBracket(close - 1) == close - 10002);
+
+    buffer.setCursor(14);
+    buffer.insertText("}");
+    assert(buffer.findMatchingBracket(13) == 14);
+    assert(buffer.findMatchingBracket(close + 1) == std::nullopt);
+    buffer.backspace(1);
+    assert(buffer.findMatchingBracket(13) == close);
+
+    // Undo and redo update the index over just the range they restore
+    buffer.commit();
+    buffer.setCursor(14);
+    buffer.insertText("}");
+    buffer.undo();
+    assert(buffer.findMatchingBracket(13) == close);
+    buffer.redo();
+    assert(buffer.findMatchingBracket(13) == 14);
+    assert(buffer.findMatchingBracket(close + 1) == std::nullopt);
+    buffer.undo();
+
+    buffer.setCursor(0);
+    assert(buffer.jumpToMatchingBracket());
+    assert(buffer.getCursor() == 11);
+
+    std::cout << "PASSED" << std::endl;
+}
+
+void test_indent_cache() {
+    std::cout << "Running test_indent_cache...";
+
+    buffer::EditorBuffer buffer("a\n    b\n\tc\n  \n");
+    assert(buffer.getIndentWidth(0) == 0);
+    assert(buffer.getIndentWidth(1) == 4);
+    assert(buffer.getIndentWidth(2) == 4);
+    assert(buffer.getIndentWidth(3) == std::nullopt);
+
+    // Only the edited line is recomputed, and new lines shift the rows below
+    buffer.setCursor(2);
+    buffer.insertText("  x\n");
+    assert(buffer.getIndentWidth(1) == 2);
+    assert(buffer.getIndentWidth(2) == 4);
+    assert(buffer.getIndentWidth(3) == 4);
+    buffer.backspace(4);
+    assert(buffer.getIndentWidth(1) == 4);
+    assert(buffer.getIndentWidth(2) == 4);
+
+    buffer.setTabWidth(8);
+    assert(buffer.getIndentWidth(2) == 8);
+    assert(buffer.getIndentWidth(1) == 4);
+
+    // Blank lines carry the width above them, but only from within the scan limit
+    assert(buffer.getCarriedIndent(4) == 8);
+    buffer::EditorBuffer deep("    a" + std::string(buffer::IndentCache::CARRY_LIMIT + 1, '\n'));
+    assert(deep.getCarriedIndent(buffer::IndentCache::CARRY_LIMIT) == 4);
+    assert(deep.getCarriedIndent(buffer::IndentCache::CARRY_LIMIT + 1) == 0);
+
+    std::cout << "PASSED" << std::endl;
+}
+
+void test_transaction_undo() {
+    std::cout << "Running test_transaction_undo...";
+
+    std::string text;
+    for (int i = 0; i < 1000; i++) {
+        text += "line\n";
+    }
+    buffer::EditorBuffer buffer(text);
+
+    // Walk down the file editing every line, as a replayed macro would
+    buffer.beginTransaction();
+    for (int i = 0; i < 1000; i++) {
+        buffer.setCursorToBeginningColumn();
+        buffer.insertText("# ");
+        buffer.commit();
+        buffer.setCursorToEndingColumn();
+        buffer.backspace(1);
+        buffer.moveDown();
+    }
+    buffer.endTransaction();
+    assert(buffer.getLineCount() == 1001);
+    assert(buffer.getCursorPosition2D() == (std::pair<size_t, size_t>{1000, 0}));
+    assert(buffer.snapshot().getLine(999) == "# lin");
+
+    buffer.undo();
+    assert(buffer.getText() == text);
+    buffer.redo();
+    assert(buffer.snapshot().getLine(0) == "# lin");
+
+    std::cout << "PASSED" << std::endl;
+}
+
+void test_counted_deletes() {
+    std::cout << "Running test_counted_deletes...";
+
+    std::string text;
+    for (int i = 0; i < 20000; i++) {
+        text += "line " + std::to_string(i) + "\n";
+    }
+    buffer::EditorBuffer buffer(text);
+    buffer.moveDown(5);
+    assert(buffer.getCursorPosition2D().first == 5);
+
+    buffer.commit();
+    buffer.deleteLines(10000);
+    assert(buffer.getLineCount() == 10001);
+    assert(buffer.snapshot().getLine(5) == "line 10005");
+    assert(buffer.getCursorPosition2D() == (std::pair<size_t, size_t>{5, 0}));
+
+    buffer.commit();
+    buffer.deleteChars(50);
+    assert(buffer.snapshot().getLine(5).empty());
+    assert(buffer.getLineCount() == 10001);
+
+    // Deleting through the last line takes the newline before it
+    buffer.commit();
+    buffer.moveDown(100000);
+    buffer.moveUp(2);
+    buffer.deleteLines(100);
+    assert(buffer.getLineCount() == 9998);
+    assert(buffer.snapshot().getLine(9997) == "line 19997");
+
+    buffer.undo();
+    assert(buffer.getLineCount() == 10001);
+    buffer.undo();
+    assert(buffer.snapshot().getLine(5) == "line 10005");
+    buffer.undo();
+    assert(buffer.getText() == text);
+
+    std::cout << "PASSED" << std::endl;
+}
+
+void test_range_edits() {
+    std::cout << "Running test_range_edits...";
+
+    buffer::PieceTable table("0123456789");
+    table.insert(2, "-");
+    table.insert(5, "-");
+    table.insert(8, "-");
+    assert(table.getText() == "01-23-45-6789");
+    assert(table.getPieceCount() == 7);
+    table.eraseRange(1, 11);
+    assert(table.getText() == "089");
+    table.replace(1, 1, "abc");
+    assert(table.getText() == "0abc9");
+    assert(table.getPieceCount() == 3);
+
+    buffer::EditorBuffer buffer("one\ntwo\nthree\nfour");
+    buffer.setCursor(15);
+    buffer.eraseRange(2, 10);
+    assert(buffer.getText() == "onree\nfour");
+    assert(buffer.getLineCount() == 2);
+    assert(buffer.getCursor() == 7);
+
+    buffer.replace(0, 6, "a\nb\nc\n");
+    assert(buffer.getText() == "a\nb\nc\nfour");
+    assert(buffer.snapshot().getLine(3) == "four");
+    assert(buffer.getCursorPosition2D() == (std::pair<size_t, size_t>{3, 1}));
+
+    // Overwriting stops at the end of the line and counts characters, not bytes
+    buffer.setCursor(8);
+    buffer.overwrite("xyz");
+    assert(buffer.getText() == "a\nb\nc\nfoxyz");
+    buffer.setCursor(0);
+    buffer.replace(0, 1, "\xc3\xa9");
+    buffer.setCursor(0);
+    buffer.overwrite("e");
+    assert(buffer.getText() == "e\nb\nc\nfoxyz");
+
+    std::cout << "PASSED" << std::endl;
+}
+
+void test_damage_tracking() {
+    std::cout << "Running test_damage_tracking...";
+
+    buffer::EditorBuffer buffer("one\ntwo\nthree\nfour");
+    assert(!buffer.takeDamagedRows());
+
+    // An edit that keeps the line count damages only the rows it touched
+    buffer.replace(5, 1, "W");
+    buffer.replace(9, 2, "R");
+    assert(buffer.takeDamagedRows() == (std::pair<size_t, size_t>{1, 3}));
+    assert(!buffer.takeDamagedRows());
+
+    // Adding or removing a line shifts everything below it
+    buffer.setCursor(4);
+    buffer.insertText("\n");
+    assert(buffer.takeDamagedRows() == (std::pair<size_t, size_t>{1, SIZE_MAX}));
+
+    buffer.setCursor(0);
+    buffer.moveDown(3);
+    assert(!buffer.takeDamagedRows());
+
+    // Undo and redo damage only the rows that differ from the state they restore
+    buffer.commit();
+    buffer.undo();
+    assert(!buffer.takeDamagedRows());
+    buffer.undo();
+    assert(buffer.getText() == "one\ntwo\nthree\nfour");
+    assert(buffer.takeDamagedRows() == (std::pair<size_t, size_t>{1, SIZE_MAX}));
+    buffer.redo();
+    assert(buffer.takeDamagedRows() == (std::pair<size_t, size_t>{1, SIZE_MAX}));
+
+    std::cout << "PASSED" << std::endl;
+}
+
+void test_word_wrap() {
+    std::cout << "Running test_word_wrap...";
+
+    buffer::EditorBuffer buffer("hello world again\nab\n\taaaaaaaaaaaaaaaaaa");
+    buffer.setTabWidth(4);
+    buffer.setWrapWidth(10);
+    // Unmeasured lines count as one row until they come into view
+    assert(buffer.getVisualRowCount() == 3);
+    buffer.measureWrap(0, 0, SIZE_MAX);
+    // "hello " | "world " | "again", then "ab", then the tab alone and 18 a's broken mid-word
+    assert(buffer.getVisualRowCount() == 7);
+    assert(buffer.getVisualRow(1) == 3 && buffer.getVisualRow(2) == 4);
+    assert(buffer.locateVisualRow(2) == (std::pair<size_t, size_t>{0, 2}));
+    assert(buffer.locateVisualRow(3) == (std::pair<size_t, size_t>{1, 0}));
+    assert(buffer.getVisualRowOf(6) == 1 && buffer.getVisualRowOf(5) == 0);
+    assert(buffer.takeDamagedRows() == (std::pair<size_t, size_t>{0, SIZE_MAX}));
+
+    // An edit forgets only the lines it touched
+    buffer.setCursor(19);
+    buffer.insertText("cdefghijklmn");
+    assert(buffer.getVisualRowCount() == 7);
+    buffer.measureWrap(1, 0, 1);
+    assert(buffer.getVisualRowCount() == 8);
+    assert(buffer.locateVisualRow(4) == (std::pair<size_t, size_t>{1, 1}));
+
+    // Undo forgets only the lines it restores
+    buffer.commit();
+    buffer.setCursor(0);
+    buffer.insertText("x");
+    buffer.undo();
+    buffer.measureWrap(0, 0, 1);
+    assert(buffer.getVisualRowCount() == 8);
+
+    // A new width keeps the old counts until the lines are measured again
+    buffer.setWrapWidth(100);
+    assert(buffer.getVisualRowCount() == 8);
+    while (buffer.refineWrap(1)) {
+    }
+    assert(buffer.getVisualRowCount() == 3);
+
+    buffer.setWrapWidth(0);
+    assert(buffer.getVisualRowCount() == 3 && buffer.locateVisualRow(2) == (std::pair<size_t, size_t>{2, 0}));
+
+    std::cout << "PASSED" << std::endl;
+}
+
+void test_word_wrap_chunks() {
+    std::cout << "Running test_word_wrap_chunks...";
+
+    // Lines of 1 to 4 rows across many chunks, edited at chunk boundaries and checked against a
+    // plain count
+    std::string text;
+    for (int i = 0; i < 5000; i++) {
+        text += std::string((i % 4) * 8 + 1, 'x') + "\n";
+    }
+    buffer::EditorBuffer buffer(text);
+    buffer.setWrapWidth(8);
+    while (buffer.refineWrap(4096)) {
+    }
+
+    auto check = [&]() {
+        std::string current = buffer.getText();
+        size_t visual = 0, line = 0, start = 0;
+        for (size_t i = 0; i <= current.size(); i++) {
+            if (i < current.size() && current[i] != '\n') {
+                continue;
+            }
+            size_t rows = std::max<size_t>(1, (i - start + 7) / 8);
+            assert(buffer.getVisualRow(line) == visual);
+            assert(buffer.locateVisualRow(visual + rows - 1) == (std::pair<size_t, size_t>{line, rows - 1}));
+            visual += rows;
+            line++;
+            start = i + 1;
+        }
+        assert(buffer.getVisualRowCount() == visual);
+    };
+    check();
+
+    buffer.replace(buffer.getLineStart(1020), 0, std::string(3000, '\n'));
+    buffer.replace(buffer.getLineStart(10), buffer.getLineStart(2500) - buffer.getLineStart(10), "");
+    buffer.replace(buffer.getLineStart(7), 0, "xxxxxxxxxxxxxxxxxxxxxxxx");
+    while (buffer.refineWrap(4096)) {
+    }
+    buffer.measureWrap(0, 0, SIZE_MAX);
+    check();
+
+    buffer.commit();
+    buffer.undo();
+    buffer.measureWrap(0, 0, SIZE_MAX);
+    check();
+
+    std::cout << "PASSED" << std::endl;
+}
@@ -1,4 +1,5 @@
 #include "buffer.cpp"
+#include "trace.cpp"
 #include <iostream>
 
 int main() {
@@ -15,6 +16,22 @@ int main() {
     test_consecutive_inserts();
     test_undo_redo();
     test_get_character_from_cursor();
+    test_snapshot_isolation();
+    test_snapshot_pending_shift();
+    test_manager_eviction();
+    test_manager_save();
+    test_word_motions();
+    test_text_objects();
+    test_bracket_matching();
+    test_indent_cache();
+    test_transaction_undo();
+    test_counted_deletes();
+    test_range_edits();
+    test_damage_tracking();
+    test_word_wrap();
+    test_word_wrap_chunks();
+    test_trace_round_trip();
+    test_trace_rejects_truncated();
 
     std::cout << "--- All Tests Passed! ---\n";
     return 0;
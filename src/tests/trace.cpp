@@ -0,0 +1,101 @@
+#pragma once
+#include <blip/app/trace.hpp>
+#include <cassert>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace {
+SDL_Event textEvent(const char *text) {
+    SDL_Event event{};
+    event.type = SDL_TEXTINPUT;
+    std::strcpy(event.text.text, text);
+    return event;
+}
+
+SDL_Event keyEvent(SDL_Keycode sym, Uint16 mod) {
+    SDL_Event event{};
+    event.type = SDL_KEYDOWN;
+    event.key.keysym.sym = sym;
+    event.key.keysym.mod = mod;
+    return event;
+}
+}
+
+void test_trace_round_trip() {
+    std::cout << "Running test_trace_round_trip...";
+
+    SDL_Event decoded;
+    std::string data;
+    app::encodeEvent(data, textEvent("h\xc3\xa9llo"));
+    assert(app::decodeEvent(data, 0, decoded) == data.size());
+    assert(decoded.type == SDL_TEXTINPUT);
+    assert(std::strcmp(decoded.text.text, "h\xc3\xa9llo") == 0);
+
+    data.clear();
+    app::encodeEvent(data, keyEvent(SDLK_z, KMOD_CTRL | KMOD_SHIFT));
+    assert(app::decodeEvent(data, 0, decoded) == data.size());
+    assert(decoded.type == SDL_KEYDOWN);
+    assert(decoded.key.keysym.sym == SDLK_z);
+    assert(decoded.key.keysym.mod == (KMOD_CTRL | KMOD_SHIFT));
+
+    // Events other than key and text input are not recorded
+    SDL_Event wheel{};
+    wheel.type = SDL_MOUSEWHEEL;
+    data.clear();
+    app::encodeEvent(data, wheel);
+    assert(data.empty());
+
+    auto path = (std::filesystem::temp_directory_path() / "blip_test_trace.bin").string();
+    {
+        app::TraceRecorder recorder;
+        assert(recorder.open(path));
+        recorder.record(textEvent("a"));
+        recorder.record(wheel);
+        recorder.record(keyEvent(SDLK_RETURN, 0));
+        recorder.record(textEvent(""));
+    }
+    auto events = app::loadTrace(path);
+    assert(events && events->size() == 3);
+    assert((*events)[0].type == SDL_TEXTINPUT && std::strcmp((*events)[0].text.text, "a") == 0);
+    assert((*events)[1].type == SDL_KEYDOWN && (*events)[1].key.keysym.sym == SDLK_RETURN);
+    assert((*events)[1].key.keysym.mod == 0);
+    assert((*events)[2].type == SDL_TEXTINPUT && (*events)[2].text.text[0] == '\0');
+
+    std::filesystem::remove(path);
+    std::cout << "PASSED" << std::endl;
+}
+
+void test_trace_rejects_truncated() {
+    std::cout << "Running test_trace_rejects_truncated...";
+
+    auto path = (std::filesystem::temp_directory_path() / "blip_test_trace.bin").string();
+    {
+        app::TraceRecorder recorder;
+        assert(recorder.open(path));
+        recorder.record(textEvent("abc"));
+        recorder.record(keyEvent(SDLK_ESCAPE, 0));
+    }
+    std::string whole;
+    {
+        std::ifstream in(path, std::ios::binary);
+        whole.assign(std::istreambuf_iterator<char>(in), {});
+    }
+    assert(app::loadTrace(path));
+
+    // Cut inside the key event, then drop it and the last byte of the text
+    size_t key_size = 1 + sizeof(SDL_Keycode) + sizeof(Uint16);
+    for (size_t cut : {whole.size() - 1, whole.size() - key_size - 1}) {
+        std::ofstream(path, std::ios::binary | std::ios::trunc).write(whole.data(), (std::streamsize)cut);
+        assert(!app::loadTrace(path));
+    }
+
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "not a trace";
+    assert(!app::loadTrace(path));
+    std::filesystem::remove(path);
+    assert(!app::loadTrace(path));
+
+    std::cout << "PASSED" << std::endl;
+}
@@ -0,0 +1,178 @@
+#include <blip/platform/system.hpp>
+#include <blip/text/fallback.hpp>
+#include <blip/text/font_manager.hpp>
+#include <iostream>
+
+namespace text {
+FontFallback::FontFallback(WakeCallback wake) : wake(wake), worker(&FontFallback::loop, this) {}
+
+FontFallback::~FontFallback() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    ready.notify_one();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    for (Answer &answer : answers) {
+        if (answer.font) {
+            closeFont(answer.font);
+        }
+    }
+    closeFaces();
+}
+
+void FontFallback::reset(TTF_Font *new_primary, int new_size) {
+    closeFaces();
+    primary = new_primary;
+    size = new_size;
+    coverage.clear();
+}
+
+TTF_Font *FontFallback::fontFor(Uint32 codepoint) {
+    if (primary == nullptr || codepoint < 128) {
+        return primary;
+    }
+    auto it = coverage.find(codepoint);
+    if (it != coverage.end()) {
+        return face(it->second);
+    }
+
+    uint32_t entry = PENDING;
+    if (TTF_GlyphIsProvided32(primary, codepoint)) {
+        entry = PRIMARY;
+    } else if (auto known = resolved.find(codepoint); known != resolved.end()) {
+        entry = known->second;
+    } else {
+        for (uint32_t i = 0; i < faces.size(); i++) {
+            if (faces[i] && TTF_GlyphIsProvided32(faces[i], codepoint)) {
+                entry = i + 1;
+                break;
+            }
+        }
+    }
+    coverage[codepoint] = entry;
+    if (entry == PENDING) {
+        request({codepoint, "", 0});
+    }
+    return face(entry);
+}
+
+bool FontFallback::poll(std::vector<Uint32> &changed) {
+    changed.clear();
+    std::vector<Answer> arrived;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        arrived.swap(answers);
+    }
+    for (Answer &answer : arrived) {
+        size_t index = 0;
+        while (index < paths.size() && paths[index] != answer.path) {
+            index++;
+        }
+
+        if (answer.font) {
+            // Faces opened for a size that has since been reset are stale.
+            if (index == paths.size() || states[index] != FaceState::OPENING || answer.size != size) {
+                closeFont(answer.font);
+                continue;
+            }
+            faces[index] = answer.font;
+            states[index] = FaceState::OPEN;
+            for (const auto &[codepoint, entry] : coverage) {
+                if (entry == index + 1) {
+                    changed.push_back(codepoint);
+                }
+            }
+            continue;
+        }
+        if (answer.size != 0) {
+            if (index < paths.size() && states[index] == FaceState::OPENING && answer.size == size) {
+                std::cerr << "Could not open fallback font " << answer.path << std::endl;
+                states[index] = FaceState::FAILED;
+            }
+            continue;
+        }
+
+        uint32_t entry = MISSING;
+        if (!answer.path.empty()) {
+            if (index == paths.size()) {
+                paths.push_back(answer.path);
+                faces.push_back(nullptr);
+                states.push_back(FaceState::CLOSED);
+            }
+            entry = (uint32_t)index + 1;
+            // Drawn with the primary font until the face has been opened.
+            face(entry);
+        }
+        resolved[answer.codepoint] = entry;
+        coverage[answer.codepoint] = entry;
+        if (entry != MISSING && faces[index]) {
+            changed.push_back(answer.codepoint);
+        }
+    }
+    return !changed.empty();
+}
+
+// The primary font stands in until the worker has opened the face.
+TTF_Font *FontFallback::face(uint32_t entry) {
+    if (entry == PRIMARY || entry == PENDING || entry == MISSING) {
+        return primary;
+    }
+    size_t index = entry - 1;
+    if (states[index] == FaceState::CLOSED) {
+        states[index] = FaceState::OPENING;
+        request({0, paths[index], size});
+    }
+    return faces[index] ? faces[index] : primary;
+}
+
+void FontFallback::request(Request next) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        requests.push_back(std::move(next));
+    }
+    ready.notify_one();
+}
+
+void FontFallback::closeFaces() {
+    for (TTF_Font *&open : faces) {
+        if (open) {
+            closeFont(open);
+            open = nullptr;
+        }
+    }
+    states.assign(states.size(), FaceState::CLOSED);
+}
+
+void FontFallback::loop() {
+    while (true) {
+        std::vector<Request> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this]() { return !running || !requests.empty(); });
+            if (!running) {
+                return;
+            }
+            batch.swap(requests);
+        }
+
+        std::vector<Answer> found;
+        for (Request &next : batch) {
+            if (next.path.empty()) {
+                found.push_back({next.codepoint, platform::getFallbackPath(next.codepoint), 0, nullptr});
+            } else {
+                found.push_back({0, next.path, next.size, openFont(next.path, next.size)});
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            answers.insert(answers.end(), found.begin(), found.end());
+        }
+        if (wake) {
+            wake();
+        }
+    }
+}
+}
@@ -0,0 +1,81 @@
+#include <blip/text/font_cache.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace text {
+namespace {
+std::string keyOf(const std::string &family, const std::string &style) { return family + '\t' + style; }
+
+std::optional<int64_t> mtimeOf(const std::string &path) {
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(path, error);
+    if (error) {
+        return std::nullopt;
+    }
+    return (int64_t)time.time_since_epoch().count();
+}
+}
+
+FontPathCache::FontPathCache(std::string file) : file(std::move(file)) {}
+
+std::optional<std::string> FontPathCache::lookup(const std::string &family, const std::string &style) {
+    std::lock_guard<std::mutex> lock(mutex);
+    load();
+    auto it = entries.find(keyOf(family, style));
+    if (it == entries.end() || mtimeOf(it->second.path) != it->second.mtime) {
+        return std::nullopt;
+    }
+    return it->second.path;
+}
+
+void FontPathCache::store(const std::string &family, const std::string &style, const std::string &path) {
+    auto mtime = mtimeOf(path);
+    if (!mtime) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    load();
+    Entry &entry = entries[keyOf(family, style)];
+    if (entry.path == path && entry.mtime == *mtime) {
+        return;
+    }
+    entry = {path, *mtime};
+    save();
+}
+
+// One entry per line: family, style, mtime and path, separated by tabs.
+void FontPathCache::load() {
+    if (loaded) {
+        return;
+    }
+    loaded = true;
+    std::ifstream in(file);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string family, style, mtime, path;
+        if (std::getline(fields, family, '\t') && std::getline(fields, style, '\t') && std::getline(fields, mtime, '\t') &&
+            std::getline(fields, path) && !path.empty()) {
+            entries[keyOf(family, style)] = {path, std::strtoll(mtime.c_str(), nullptr, 10)};
+        }
+    }
+}
+
+// Written beside the cache and renamed over it, so a crash never leaves half a file.
+void FontPathCache::save() {
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(file).parent_path(), error);
+    std::string temporary = file + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        if (!out) {
+            return;
+        }
+        for (const auto &[key, entry] : entries) {
+            out << key << '\t' << entry.mtime << '\t' << entry.path << '\n';
+        }
+    }
+    std::filesystem::rename(temporary, file, error);
+}
+}
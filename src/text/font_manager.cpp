@@ -4,36 +4,174 @@
 #include <iostream>
 
 namespace text {
-FontManager::FontManager() : current_font(nullptr), current_size(config::defaults::font::SIZE) {}
+namespace {
+std::mutex &faceMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+}
+
+TTF_Font *openFont(const std::string &path, int size) {
+    std::lock_guard<std::mutex> lock(faceMutex());
+    return TTF_OpenFont(path.c_str(), size);
+}
+
+void closeFont(TTF_Font *font) {
+    std::lock_guard<std::mutex> lock(faceMutex());
+    TTF_CloseFont(font);
+}
+
+FontManager::FontManager(WakeCallback wake)
+    : current({nullptr, 0}), current_size(config::defaults::font::SIZE), next_id(1), clock(0),
+      cache(platform::getCacheDir() + "/fonts"), wake(wake), refresher(&FontManager::refreshLoop, this) {}
+
 FontManager::~FontManager() {
-    if (current_font) {
-        TTF_CloseFont(current_font);
+    {
+        std::lock_guard<std::mutex> lock(refresh_mutex);
+        running = false;
+    }
+    refresh_wanted.notify_one();
+    if (refresher.joinable()) {
+        refresher.join();
+    }
+    for (OpenFace &open : faces) {
+        closeFont(open.face.font);
     }
 }
 
 bool FontManager::updateFont(std::string &family, std::string &style, int size) {
-    if (family == current_family && style == current_style && size == current_size) {
+    std::string refreshed;
+    {
+        std::lock_guard<std::mutex> lock(refresh_mutex);
+        if (refresh_answer_for && refresh_answer_for->first == current_family &&
+            refresh_answer_for->second == current_style) {
+            refreshed = refresh_answer;
+        }
+        refresh_answer_for.reset();
+    }
+    bool same = family == current_family && style == current_style && size == current_size;
+    if (same && (refreshed.empty() || refreshed == current_path)) {
         return false;
     }
 
-    std::string path = platform::getTTFPath(family, style);
-    TTF_Font *new_font = TTF_OpenFont(path.c_str(), size);
+    std::string path;
+    bool from_cache = false;
+    if (same) {
+        path = refreshed;
+    } else {
+        path = resolve(family, style, from_cache);
+    }
+    Face face = open(path, style, size);
+    if (face.font == NULL && from_cache) {
+        path = platform::getTTFPath(family, style);
+        cache.store(family, style, path);
+        from_cache = false;
+        face = open(path, style, size);
+    }
 
-    if (new_font == NULL) {
+    if (face.font == NULL) {
         std::cerr << "Could not open font " << TTF_GetError() << std::endl;
         exit(EXIT_FAILURE);
     }
 
-    if (current_font) {
-        TTF_CloseFont(current_font);
-    }
-
-    current_font = new_font;
+    bool changed = face.id != current.id;
+    current = face;
     current_family = family;
     current_style = style;
+    current_path = path;
     current_size = size;
-    return true;
+    if (from_cache) {
+        startRefresh(family, style);
+    }
+    return changed;
+}
+
+TTF_Font *FontManager::getFont() const { return current.font; }
+
+uint64_t FontManager::getGeneration() const { return current.id; }
+
+std::string FontManager::resolve(const std::string &family, const std::string &style, bool &from_cache) {
+    if (auto cached = cache.lookup(family, style)) {
+        from_cache = true;
+        return *cached;
+    }
+    from_cache = false;
+    std::string path = platform::getTTFPath(family, style);
+    cache.store(family, style, path);
+    return path;
+}
+
+// Past MAX_FACES the least recently used face other than the current one is closed.
+Face FontManager::open(const std::string &path, const std::string &style, int size) {
+    clock++;
+    for (OpenFace &open : faces) {
+        if (open.path == path && open.size == size && open.style == style) {
+            open.used = clock;
+            return open.face;
+        }
+    }
+
+    TTF_Font *font = openFont(path, size);
+    if (font == NULL) {
+        return {nullptr, 0};
+    }
+    if (faces.size() >= MAX_FACES) {
+        auto oldest = faces.end();
+        for (auto it = faces.begin(); it != faces.end(); it++) {
+            if (it->face.id != current.id && (oldest == faces.end() || it->used < oldest->used)) {
+                oldest = it;
+            }
+        }
+        if (oldest != faces.end()) {
+            closeFont(oldest->face.font);
+            faces.erase(oldest);
+        }
+    }
+    faces.push_back({path, style, size, {font, next_id++}, clock});
+    return faces.back().face;
 }
 
-TTF_Font *FontManager::getFont() const { return current_font; }
+// Fontconfig may have changed since the cache was written, for example after a font install. Each
+// (family, style) is confirmed once per run, however often the size changes.
+void FontManager::startRefresh(const std::string &family, const std::string &style) {
+    if (family == refreshing_family && style == refreshing_style) {
+        return;
+    }
+    refreshing_family = family;
+    refreshing_style = style;
+    {
+        std::lock_guard<std::mutex> lock(refresh_mutex);
+        refresh_request.emplace(family, style);
+    }
+    refresh_wanted.notify_one();
+}
+
+void FontManager::refreshLoop() {
+    while (true) {
+        std::pair<std::string, std::string> request;
+        {
+            std::unique_lock<std::mutex> lock(refresh_mutex);
+            refresh_wanted.wait(lock, [this]() { return !running || refresh_request.has_value(); });
+            if (!running) {
+                return;
+            }
+            request = std::move(*refresh_request);
+            refresh_request.reset();
+        }
+
+        std::string path = platform::getTTFPath(request.first, request.second);
+        if (path.empty()) {
+            continue;
+        }
+        cache.store(request.first, request.second, path);
+        {
+            std::lock_guard<std::mutex> lock(refresh_mutex);
+            refresh_answer_for = std::move(request);
+            refresh_answer = path;
+        }
+        if (wake) {
+            wake();
+        }
+    }
+}
 }
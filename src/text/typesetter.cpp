@@ -0,0 +1,193 @@
+#include <blip/text/typesetter.hpp>
+#include <algorithm>
+#include <cstring>
+
+namespace text {
+namespace {
+constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+constexpr uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// The characters programming fonts build ligatures from, as in ->, !=, <=>, && or ::.
+bool joinsLigature(Uint32 codepoint) {
+    return codepoint > 0 && codepoint < 128 && std::strchr("!#$%&*+-./:;<=>?@\\^|~", (int)codepoint) != nullptr;
+}
+}
+
+Typesetter::Typesetter(size_t capacity) : slots(std::max<size_t>(1, capacity)), layouts(slots.size()) {
+    size_t bucket_count = 1;
+    while (bucket_count < slots.size() * 2) {
+        bucket_count <<= 1;
+    }
+    buckets.assign(bucket_count, NONE);
+    for (uint32_t i = 0; i < slots.size(); i++) {
+        pushFront(i);
+    }
+}
+
+bool Typesetter::configure(const FontMetrics &new_metrics, size_t new_tab_width, float new_line_height,
+                           bool new_ligatures) {
+    new_tab_width = std::max<size_t>(1, new_tab_width);
+    if (new_metrics.generation == metrics.generation && new_metrics.cell_width == metrics.cell_width &&
+        new_tab_width == tab_width && new_line_height == line_height && new_ligatures == ligatures) {
+        return false;
+    }
+    metrics = new_metrics;
+    tab_width = new_tab_width;
+    line_height = new_line_height;
+    ligatures = new_ligatures;
+    generation++;
+    return true;
+}
+
+int Typesetter::getLineHeight() const { return std::max(1, (int)(metrics.line_skip * line_height)); }
+
+int Typesetter::getBaseline() const { return (getLineHeight() - metrics.font_height) / 2; }
+
+int Typesetter::getCellWidth() const { return metrics.cell_width; }
+
+size_t Typesetter::getTabWidth() const { return tab_width; }
+
+size_t Typesetter::getCapacity() const { return slots.size(); }
+
+const LineLayout &Typesetter::layout(const buffer::Snapshot &snapshot, size_t row) {
+    size_t start = snapshot.getLineStart(row);
+    size_t end = start + snapshot.getLineLength(row);
+
+    uint64_t hash = FNV_OFFSET;
+    size_t remaining = end - start;
+    snapshot.iteratorAt(start).skipForward([&](char c) {
+        if (remaining == 0) {
+            return false;
+        }
+        remaining--;
+        hash = (hash ^ (unsigned char)c) * FNV_PRIME;
+        return true;
+    });
+    uint64_t key = mix(hash ^ mix((end - start) + (generation << 40)));
+
+    uint32_t &bucket = buckets[key & (buckets.size() - 1)];
+    for (uint32_t i = bucket; i != NONE; i = slots[i].chain) {
+        if (slots[i].key == key) {
+            unlink(i);
+            pushFront(i);
+            return layouts[i];
+        }
+    }
+
+    // Pinned layouts were used recently, so the least recent unpinned one is found near the tail.
+    uint32_t index = tail;
+    while (slots[index].pins > 0) {
+        index = slots[index].prev;
+    }
+    Slot &slot = slots[index];
+    if (slot.used) {
+        unchain(index);
+    }
+    unlink(index);
+    build(snapshot, start, end, layouts[index]);
+    slot.key = key;
+    slot.used = true;
+    slot.chain = bucket;
+    bucket = index;
+    pushFront(index);
+    return layouts[index];
+}
+
+void Typesetter::pin(const LineLayout &layout) { slots[&layout - layouts.data()].pins++; }
+
+void Typesetter::unpin(const LineLayout &layout) { slots[&layout - layouts.data()].pins--; }
+
+void Typesetter::unlink(uint32_t index) {
+    Slot &slot = slots[index];
+    (slot.prev == NONE ? head : slots[slot.prev].next) = slot.next;
+    (slot.next == NONE ? tail : slots[slot.next].prev) = slot.prev;
+    slot.prev = slot.next = NONE;
+}
+
+void Typesetter::pushFront(uint32_t index) {
+    Slot &slot = slots[index];
+    slot.prev = NONE;
+    slot.next = head;
+    (head == NONE ? tail : slots[head].prev) = index;
+    head = index;
+}
+
+void Typesetter::unchain(uint32_t index) {
+    uint32_t *link = &buckets[slots[index].key & (buckets.size() - 1)];
+    while (*link != index) {
+        link = &slots[*link].chain;
+    }
+    *link = slots[index].chain;
+    slots[index].chain = NONE;
+    slots[index].used = false;
+}
+
+// Decodes UTF-8 (malformed bytes become U+FFFD) and places each codepoint on the cell grid, with
+// tabs running to the next tab stop. The glyph vector keeps its capacity between lines.
+void Typesetter::build(const buffer::Snapshot &snapshot, size_t start, size_t end, LineLayout &out) {
+    out.glyphs.clear();
+    size_t index = start, column = 0;
+    buffer::Utf8Decoder decoder;
+
+    auto place = [&](Uint32 codepoint, size_t at) {
+        size_t cells = codepoint == '\t' ? tab_width - column % tab_width : 1;
+        out.glyphs.push_back({codepoint, (Uint32)(at - start), (Uint32)column, (Uint32)cells,
+                              (float)(column * metrics.cell_width)});
+        column += cells;
+    };
+
+    snapshot.iteratorAt(start).skipForward([&](char c) {
+        if (index >= end) {
+            return false;
+        }
+        decoder.push(index++, (unsigned char)c, place);
+        return true;
+    });
+    decoder.finish(place);
+
+    out.columns = column;
+    out.width = (float)(column * metrics.cell_width);
+    out.runs.clear();
+    if (ligatures) {
+        findRuns(out);
+    }
+}
+
+// Longer runs, like comment rules, are left to single glyphs rather than filling the atlas.
+void Typesetter::findRuns(LineLayout &out) const {
+    size_t count = out.glyphs.size();
+    for (size_t i = 0; i < count;) {
+        if (!joinsLigature(out.glyphs[i].codepoint)) {
+            i++;
+            continue;
+        }
+        size_t first = i;
+        while (i < count && joinsLigature(out.glyphs[i].codepoint)) {
+            i++;
+        }
+        if (i - first >= 2 && i - first <= MAX_LIGATURE_RUN) {
+            out.runs.push_back({(Uint32)first, (Uint32)(i - first)});
+        }
+    }
+}
+
+void Typesetter::wrap(const LineLayout &line, size_t width, std::vector<size_t> &rows) const {
+    rows.assign(1, 0);
+    if (width == 0) {
+        return;
+    }
+    buffer::WordWrap wrap(width);
+    for (size_t i = 0; i < line.glyphs.size(); i++) {
+        const PositionedGlyph &glyph = line.glyphs[i];
+        wrap.feed(i, glyph.cells, glyph.codepoint == ' ' || glyph.codepoint == '\t',
+                  [&](size_t position) { rows.push_back(position); });
+    }
+}
+}
@@ -0,0 +1,260 @@
+#include <blip/ui/atlas.hpp>
+#include <algorithm>
+#include <iostream>
+
+namespace ui {
+namespace {
+constexpr int INITIAL_SIZE = 512;
+constexpr int FALLBACK_MAX_SIZE = 4096;
+constexpr int PADDING = 1;
+
+uint64_t texture_uploads = 0;
+}
+
+GlyphAtlas::GlyphAtlas()
+    : renderer(nullptr), font(nullptr), fallback(nullptr), texture(nullptr), size(0), shelf_x(0), shelf_y(0), shelf_height(0),
+      cell_width(0), font_height(0), line_skip(0) {
+    ascii_ready.fill(false);
+}
+
+GlyphAtlas::~GlyphAtlas() {
+    if (texture) {
+        SDL_DestroyTexture(texture);
+    }
+}
+
+void GlyphAtlas::reset(SDL_Renderer *new_renderer, TTF_Font *new_font) {
+    renderer = new_renderer;
+    font = new_font;
+    vertices.clear();
+    indices.clear();
+    clearGlyphs();
+    if (renderer == nullptr || font == nullptr) {
+        return;
+    }
+
+    font_height = TTF_FontHeight(font);
+    line_skip = TTF_FontLineSkip(font);
+    createTexture(std::max(size, INITIAL_SIZE));
+    for (Uint32 c = 32; c < 127; c++) {
+        get(c);
+    }
+    cell_width = ascii_ready[' '] ? ascii[' '].advance : 0;
+}
+
+bool GlyphAtlas::isReady() const { return texture != nullptr && cell_width > 0; }
+
+void GlyphAtlas::setFallback(text::FontFallback *new_fallback) { fallback = new_fallback; }
+
+// The old pixels stay in the texture until it is next rebuilt.
+void GlyphAtlas::forget(const std::vector<Uint32> &codepoints) {
+    for (Uint32 codepoint : codepoints) {
+        if (codepoint < ascii.size()) {
+            ascii_ready[codepoint] = false;
+        } else {
+            glyphs.erase(codepoint);
+        }
+    }
+}
+
+int GlyphAtlas::getCellWidth() const { return cell_width; }
+
+int GlyphAtlas::getFontHeight() const { return font_height; }
+
+int GlyphAtlas::getLineSkip() const { return line_skip; }
+
+const Glyph *GlyphAtlas::get(Uint32 codepoint) {
+    if (codepoint < ascii.size() && ascii_ready[codepoint]) {
+        return &ascii[codepoint];
+    }
+    if (codepoint >= ascii.size()) {
+        auto it = glyphs.find(codepoint);
+        if (it != glyphs.end()) {
+            return &it->second;
+        }
+    }
+    if (texture == nullptr) {
+        return nullptr;
+    }
+
+    Glyph glyph;
+    if (!rasterize(codepoint, glyph)) {
+        return nullptr;
+    }
+    if (codepoint < ascii.size()) {
+        ascii[codepoint] = glyph;
+        ascii_ready[codepoint] = true;
+        return &ascii[codepoint];
+    }
+    return &glyphs.emplace(codepoint, glyph).first->second;
+}
+
+const Glyph *GlyphAtlas::getRun(const std::string &text) {
+    auto it = runs.find(text);
+    if (it != runs.end()) {
+        return &it->second;
+    }
+    if (texture == nullptr) {
+        return nullptr;
+    }
+    // SDL_ttf shapes whole strings with HarfBuzz but does not hand out glyph IDs, so the shaped
+    // run is rendered and cached as one image.
+    SDL_Surface *rendered = TTF_RenderUTF8_Blended(font, text.c_str(), {255, 255, 255, 255});
+    if (rendered == NULL) {
+        return nullptr;
+    }
+    Glyph glyph = {{0, 0, 0, 0}, rendered->w};
+    if (!upload(rendered, glyph)) {
+        return nullptr;
+    }
+    return &runs.emplace(text, glyph).first->second;
+}
+
+void GlyphAtlas::queue(const Glyph &glyph, float x, float y, SDL_Color color) {
+    if (glyph.source.w == 0 || glyph.source.h == 0) {
+        return;
+    }
+    float scale = 1.0f / size;
+    float u0 = glyph.source.x * scale, v0 = glyph.source.y * scale;
+    float u1 = (glyph.source.x + glyph.source.w) * scale, v1 = (glyph.source.y + glyph.source.h) * scale;
+    float x1 = x + glyph.source.w, y1 = y + glyph.source.h;
+
+    int base = (int)vertices.size();
+    vertices.push_back({{x, y}, color, {u0, v0}});
+    vertices.push_back({{x1, y}, color, {u1, v0}});
+    vertices.push_back({{x1, y1}, color, {u1, v1}});
+    vertices.push_back({{x, y1}, color, {u0, v1}});
+    for (int i : {0, 1, 2, 0, 2, 3}) {
+        indices.push_back(base + i);
+    }
+}
+
+void GlyphAtlas::flush() {
+    if (!indices.empty() && texture) {
+        SDL_RenderGeometry(renderer, texture, vertices.data(), (int)vertices.size(), indices.data(), (int)indices.size());
+    }
+    vertices.clear();
+    indices.clear();
+}
+
+void GlyphAtlas::createTexture(int new_size) {
+    if (texture) {
+        SDL_DestroyTexture(texture);
+    }
+    texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, new_size, new_size);
+    if (texture == nullptr) {
+        std::cerr << "Unable to create glyph atlas! Error: " << SDL_GetError() << std::endl;
+        size = 0;
+        return;
+    }
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    size = new_size;
+    shelf_x = shelf_y = shelf_height = 0;
+}
+
+void GlyphAtlas::clearGlyphs() {
+    ascii_ready.fill(false);
+    glyphs.clear();
+    runs.clear();
+    shelf_x = shelf_y = shelf_height = 0;
+    cell_width = 0;
+}
+
+bool GlyphAtlas::rasterize(Uint32 codepoint, Glyph &glyph) {
+    TTF_Font *face = fallback ? fallback->fontFor(codepoint) : font;
+    int advance = 0;
+    if (TTF_GlyphMetrics32(face, codepoint, NULL, NULL, NULL, NULL, &advance) != 0) {
+        return false;
+    }
+    glyph = {{0, 0, 0, 0}, advance};
+    if (codepoint == ' ') {
+        return true;
+    }
+
+    SDL_Surface *rendered = TTF_RenderGlyph32_Blended(face, codepoint, {255, 255, 255, 255});
+    if (rendered == NULL) {
+        return true;
+    }
+    return upload(rendered, glyph);
+}
+
+// Converts, packs and uploads a rendered surface, taking ownership of it. Returns false only when
+// it cannot fit even in the largest texture.
+bool GlyphAtlas::upload(SDL_Surface *rendered, Glyph &glyph) {
+    SDL_Surface *surface = SDL_ConvertSurfaceFormat(rendered, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(rendered);
+    if (surface == NULL) {
+        return true;
+    }
+
+    if (!pack(surface->w, surface->h, glyph.source)) {
+        // Full: queued quads still point into the old texture, so draw them before it goes away.
+        // Everything is rasterized again on demand at the larger size.
+        flush();
+        SDL_RendererInfo info;
+        int max_size = FALLBACK_MAX_SIZE;
+        if (SDL_GetRendererInfo(renderer, &info) == 0 && info.max_texture_width > 0) {
+            max_size = std::min(info.max_texture_width, info.max_texture_height);
+        }
+        int cell = cell_width;
+        clearGlyphs();
+        cell_width = cell;
+        createTexture(std::min(size * 2, max_size));
+        if (texture == nullptr || !pack(surface->w, surface->h, glyph.source)) {
+            SDL_FreeSurface(surface);
+            return false;
+        }
+    }
+    SDL_UpdateTexture(texture, &glyph.source, surface->pixels, surface->pitch);
+    SDL_FreeSurface(surface);
+    texture_uploads++;
+    return true;
+}
+
+bool GlyphAtlas::pack(int width, int height, SDL_Rect &rect) {
+    if (width + PADDING > size) {
+        return false;
+    }
+    if (shelf_x + width + PADDING > size) {
+        shelf_y += shelf_height;
+        shelf_x = 0;
+        shelf_height = 0;
+    }
+    if (shelf_y + height + PADDING > size) {
+        return false;
+    }
+    rect = {shelf_x, shelf_y, width, height};
+    shelf_x += width + PADDING;
+    shelf_height = std::max(shelf_height, height + PADDING);
+    return true;
+}
+
+AtlasCache::AtlasCache(size_t capacity) : capacity(std::max<size_t>(1, capacity)) {}
+
+GlyphAtlas &AtlasCache::get(SDL_Renderer *renderer, TTF_Font *font, uint64_t id, text::FontFallback *fallback) {
+    clock++;
+    for (Entry &entry : entries) {
+        if (entry.id == id) {
+            entry.used = clock;
+            return *entry.atlas;
+        }
+    }
+    if (entries.size() >= capacity) {
+        entries.erase(std::min_element(entries.begin(), entries.end(),
+                                       [](const Entry &a, const Entry &b) { return a.used < b.used; }));
+    }
+    auto atlas = std::make_unique<GlyphAtlas>();
+    atlas->setFallback(fallback);
+    atlas->reset(renderer, font);
+    entries.push_back({id, clock, std::move(atlas)});
+    return *entries.back().atlas;
+}
+
+void AtlasCache::forget(const std::vector<Uint32> &codepoints) {
+    for (Entry &entry : entries) {
+        entry.atlas->forget(codepoints);
+    }
+}
+
+uint64_t getTextureUploads() { return texture_uploads; }
+}
@@ -0,0 +1,96 @@
+#include <blip/ui/damage.hpp>
+#include <algorithm>
+#include <iostream>
+
+namespace ui {
+
+// Spans stay sorted and merged as they are added; a frame only ever has a handful of them.
+void Damage::addRows(size_t first, size_t last) {
+    if (full || first >= last) {
+        return;
+    }
+    auto it = std::lower_bound(spans.begin(), spans.end(), std::make_pair(first, first));
+    if (it != spans.begin() && std::prev(it)->second >= first) {
+        --it;
+    }
+    auto end = it;
+    while (end != spans.end() && end->first <= last) {
+        first = std::min(first, end->first);
+        last = std::max(last, end->second);
+        ++end;
+    }
+    if (it == end) {
+        spans.insert(it, {first, last});
+    } else {
+        *it = {first, last};
+        spans.erase(it + 1, end);
+    }
+}
+
+void Damage::addRow(size_t row) { addRows(row, row + 1); }
+
+void Damage::addAll() {
+    full = true;
+    spans.clear();
+}
+
+void Damage::add(const Damage &other) {
+    if (other.full) {
+        addAll();
+        return;
+    }
+    for (auto [first, last] : other.spans) {
+        addRows(first, last);
+    }
+}
+
+bool Damage::isEmpty() const { return !full && spans.empty(); }
+
+bool Damage::isFull() const { return full; }
+
+const std::vector<std::pair<size_t, size_t>> &Damage::getSpans() const { return spans; }
+
+void Damage::clear() {
+    full = false;
+    spans.clear();
+}
+
+Canvas::~Canvas() {
+    if (texture) {
+        SDL_DestroyTexture(texture);
+    }
+}
+
+bool Canvas::begin(app::AppState &appState) {
+    if (texture && valid && width == appState.window_width && height == appState.window_height) {
+        SDL_SetRenderTarget(appState.renderer, texture);
+        return true;
+    }
+    if (texture) {
+        SDL_DestroyTexture(texture);
+    }
+    width = appState.window_width;
+    height = appState.window_height;
+    texture = SDL_CreateTexture(appState.renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, width, height);
+    if (texture == NULL) {
+        // Without render targets every damaged frame is drawn straight to the window in full.
+        std::cerr << "Unable to create canvas! Error: " << SDL_GetError() << std::endl;
+        valid = false;
+        return false;
+    }
+    SDL_SetRenderTarget(appState.renderer, texture);
+    valid = true;
+    return false;
+}
+
+void Canvas::compose(app::AppState &appState) {
+    if (texture && valid) {
+        SDL_SetRenderTarget(appState.renderer, NULL);
+        SDL_RenderCopy(appState.renderer, texture, NULL, NULL);
+    }
+}
+
+void Canvas::present(app::AppState &appState) { SDL_RenderPresent(appState.renderer); }
+
+void Canvas::invalidate() { valid = false; }
+}
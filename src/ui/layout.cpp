@@ -0,0 +1,159 @@
+#include <blip/ui/layout.hpp>
+#include <algorithm>
+#include <atomic>
+
+namespace ui {
+namespace {
+// Columns before the first character that isn't a space or tab, or nothing for a blank line.
+std::optional<size_t> indentOf(const text::LineLayout &layout) {
+    for (const text::PositionedGlyph &glyph : layout.glyphs) {
+        if (glyph.codepoint != ' ' && glyph.codepoint != '\t') {
+            return glyph.column;
+        }
+    }
+    return std::nullopt;
+}
+}
+
+LayoutWorker::LayoutWorker(WakeCallback wake) : wake(wake) {
+    for (auto &list : lists) {
+        list = std::make_shared<DrawList>();
+    }
+    worker = std::thread(&LayoutWorker::loop, this);
+}
+
+LayoutWorker::~LayoutWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    ready.notify_one();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void LayoutWorker::submit(LayoutJob job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending) {
+            job.damage.add(pending->damage);
+        }
+        pending = std::move(job);
+    }
+    ready.notify_one();
+}
+
+std::shared_ptr<const DrawList> LayoutWorker::take() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::move(finished);
+}
+
+void LayoutWorker::loop() {
+    while (true) {
+        LayoutJob job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this]() { return !running || pending.has_value(); });
+            if (!running) {
+                return;
+            }
+            job = std::move(*pending);
+            pending.reset();
+        }
+
+        auto list = build(job);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            // A list the SDL thread never took is replaced, but what it would have repainted
+            // still has to be.
+            if (finished) {
+                list->damage.add(finished->damage);
+            }
+            finished = std::move(list);
+        }
+        if (wake) {
+            wake();
+        }
+    }
+}
+
+// A list nobody else holds is free. Besides the one being built, at most the finished list and
+// the one the SDL thread took are held, so one of the pool always is.
+std::shared_ptr<DrawList> LayoutWorker::reuse() {
+    for (auto &list : lists) {
+        if (list.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            for (const text::LineLayout *layout : list->pinned) {
+                typesetter.unpin(*layout);
+            }
+            list->pinned.clear();
+            list->rows.clear();
+            list->damage.clear();
+            return list;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<DrawList> LayoutWorker::build(LayoutJob &job) {
+    typesetter.configure(job.metrics, job.tab_width, job.line_height, job.ligatures);
+    const buffer::Snapshot &snapshot = job.snapshot;
+
+    auto list = reuse();
+    size_t line_count = snapshot.getLineCount();
+    size_t first = std::min(job.first_line, line_count);
+    list->sequence = job.sequence;
+    list->first_row = job.first_row;
+    list->pixel_offset = job.pixel_offset;
+    list->cell_width = typesetter.getCellWidth();
+    list->line_height = typesetter.getLineHeight();
+    list->baseline = typesetter.getBaseline();
+    list->tab_width = typesetter.getTabWidth();
+    list->overlays = job.overlays;
+    list->damage = std::move(job.damage);
+
+    // Blank lines carry the guides of the nearest line above them with content.
+    size_t carried = job.carried_indent;
+
+    // Every list may pin one layout per row, and the cache must keep a slot to build in.
+    size_t row_count = std::min(job.row_count, typesetter.getCapacity() / LISTS - 1);
+    list->rows.reserve(row_count);
+    list->pinned.reserve(row_count);
+    size_t skip = job.sub_row;
+    for (size_t line = first; line < line_count && list->rows.size() < row_count; line++) {
+        const text::LineLayout &layout = typesetter.layout(snapshot, line);
+        typesetter.pin(layout);
+        list->pinned.push_back(&layout);
+        std::optional<size_t> indent = indentOf(layout);
+        carried = indent.value_or(carried);
+        size_t start = snapshot.getLineStart(line);
+        size_t end = start + snapshot.getLineLength(line);
+        size_t visual = job.first_row + list->rows.size();
+
+        typesetter.wrap(layout, job.wrap_width, breaks);
+        if (breaks.size() == 1) {
+            if (skip == 0) {
+                list->rows.push_back({visual, start, end, carried, !indent, &layout, 0, layout.glyphs.size(), 0,
+                                      layout.columns});
+            }
+            skip = 0;
+            continue;
+        }
+        // Each row of a wrapped line starts again at the left edge; only the first draws guides.
+        for (size_t r = skip; r < breaks.size() && list->rows.size() < row_count; r++) {
+            size_t from = breaks[r], to = r + 1 < breaks.size() ? breaks[r + 1] : layout.glyphs.size();
+            size_t shift = from < layout.glyphs.size() ? layout.glyphs[from].column : layout.columns;
+            size_t columns = (to < layout.glyphs.size() ? layout.glyphs[to].column : layout.columns) - shift;
+            bool last = r + 1 == breaks.size();
+            list->rows.push_back(
+                {visual++, start, last ? end : SIZE_MAX, r == 0 ? carried : 0, false, &layout, from, to, shift, columns});
+        }
+        skip = 0;
+    }
+    // Release the text before publishing, so the next edit does not have to copy it.
+    job.snapshot = buffer::Snapshot();
+    list->laid_out = std::chrono::steady_clock::now();
+    return list;
+}
+}
@@ -1,38 +1,267 @@
-#include <blip/text/font_manager.hpp>
 #include <blip/ui/renderer.hpp>
-#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
 
 namespace ui {
+namespace {
+SDL_Color toSDL(config::Color c) { return {c.r, c.g, c.b, c.a}; }
+
+// The lines that are at least partly on screen.
+std::pair<size_t, size_t> visibleLines(app::AppState &appState, text::Typesetter &typesetter, const Viewport &viewport,
+                                       buffer::EditorBuffer &buffer) {
+    size_t line_count = buffer.getLineCount();
+    size_t rows = viewport.getVisibleRows(appState.window_height, typesetter.getLineHeight());
+    if (rows == 0 || viewport.getTopLine() >= buffer.getVisualRowCount()) {
+        return {line_count, line_count};
+    }
+    size_t first = buffer.locateVisualRow(viewport.getTopLine()).first;
+    size_t last = buffer.locateVisualRow(viewport.getTopLine() + rows - 1).first + 1;
+    return {first, std::min(last, line_count)};
+}
+
+int rowY(const DrawList &list, size_t row) {
+    return (int)(row - list.first_row) * list.line_height - list.pixel_offset;
+}
+}
+
 void drawBackground(app::AppState &appState, config::EditorConfig &state) {
     auto c = state.theme.background;
     SDL_SetRenderDrawColor(appState.renderer, c.r, c.g, c.b, c.a);
     SDL_RenderClear(appState.renderer);
 }
 
-void drawEditor(app::AppState &appState, config::EditorConfig &state, text::FontManager &fonts) {
-    TTF_Font *font = fonts.getFont();
-    if (font == NULL)
+Overlays findOverlays(app::AppState &appState, config::EditorConfig &state, text::Typesetter &typesetter,
+                      const Viewport &viewport, buffer::EditorBuffer &buffer) {
+    Overlays overlays = {buffer.getCursor(), buffer.getVisualRowOf(buffer.getCursor()), std::nullopt, 0, std::nullopt};
+    if (state.preference.bracket_matching) {
+        overlays.match = buffer.findMatchingBracket(overlays.cursor);
+        if (overlays.match) {
+            overlays.match_row = buffer.getVisualRowOf(*overlays.match);
+        }
+    }
+
+    // The scope is found over lines, then stretched over every visual row they cover.
+    auto [first, last] = visibleLines(appState, typesetter, viewport, buffer);
+    size_t cursor_row = buffer.getCursorPosition2D().first;
+    if (!state.ui.show_indent_guides || !state.preference.highlight_active_scope || cursor_row < first ||
+        cursor_row >= last) {
+        return overlays;
+    }
+    size_t tab_width = typesetter.getTabWidth();
+    auto widthAt = [&](size_t row, size_t carried) { return buffer.getIndentWidth(row).value_or(carried); };
+    size_t carried = buffer.getCarriedIndent(first);
+    for (size_t row = first; row <= cursor_row; row++) {
+        carried = widthAt(row, carried);
+    }
+    if (carried == 0) {
+        return overlays;
+    }
+    ScopeGuide scope = {(carried - 1) / tab_width * tab_width, cursor_row, cursor_row};
+    while (scope.top > first && widthAt(scope.top - 1, SIZE_MAX) > scope.column) {
+        scope.top--;
+    }
+    while (scope.bottom + 1 < last && widthAt(scope.bottom + 1, SIZE_MAX) > scope.column) {
+        scope.bottom++;
+    }
+    scope.top = buffer.getVisualRow(scope.top);
+    scope.bottom = buffer.getVisualRow(scope.bottom + 1) - 1;
+    overlays.scope = scope;
+    return overlays;
+}
+
+void damageOverlays(Damage &damage, const Overlays &before, const Overlays &after) {
+    if (before.cursor != after.cursor || before.cursor_row != after.cursor_row) {
+        damage.addRow(before.cursor_row);
+        damage.addRow(after.cursor_row);
+    }
+    if (before.match != after.match || before.match_row != after.match_row) {
+        if (before.match)
+            damage.addRow(before.match_row);
+        if (after.match)
+            damage.addRow(after.match_row);
+    }
+    bool same_scope = before.scope.has_value() == after.scope.has_value() &&
+                      (!before.scope || (before.scope->column == after.scope->column &&
+                                         before.scope->top == after.scope->top &&
+                                         before.scope->bottom == after.scope->bottom));
+    if (!same_scope) {
+        if (before.scope)
+            damage.addRows(before.scope->top, before.scope->bottom + 1);
+        if (after.scope)
+            damage.addRows(after.scope->top, after.scope->bottom + 1);
+    }
+}
+
+void drawFrame(app::AppState &appState, config::EditorConfig &state, GlyphAtlas &atlas, const DrawList &list,
+               bool full) {
+    size_t first = list.first_row, last = list.first_row + list.rows.size();
+    if (full || list.damage.isFull()) {
+        drawBackground(appState, state);
+        drawIndentGuides(appState, state, list, first, last);
+        drawEditor(appState, state, atlas, list, first, last);
         return;
+    }
 
-    SDL_Color textColor = {255, 255, 255, 255};
-    SDL_Surface *textSurface = TTF_RenderText_Blended(font, "Hello from the new UI module!", textColor);
+    auto c = state.theme.background;
+    for (auto [from, to] : list.damage.getSpans()) {
+        // A changed indent also moves the guides of the blank lines below that carry it.
+        while (state.ui.show_indent_guides && to >= first && to < last && list.rows[to - first].blank) {
+            to++;
+        }
+        size_t top = std::max(from, first), bottom = std::min(to, last);
+        if (top > bottom || (top == bottom && to != SIZE_MAX)) {
+            continue;
+        }
+        // Open-ended spans also clear whatever was drawn below the last line.
+        int y = rowY(list, top);
+        int height = (to == SIZE_MAX ? appState.window_height : rowY(list, bottom)) - y;
+        if (height <= 0) {
+            continue;
+        }
+        SDL_Rect clip = {0, y, appState.window_width, height};
+        SDL_RenderSetClipRect(appState.renderer, &clip);
+        SDL_SetRenderDrawColor(appState.renderer, c.r, c.g, c.b, c.a);
+        SDL_RenderFillRect(appState.renderer, &clip);
+        drawIndentGuides(appState, state, list, top, bottom);
+        drawEditor(appState, state, atlas, list, top, bottom);
+    }
+    SDL_RenderSetClipRect(appState.renderer, NULL);
+}
 
-    if (textSurface == NULL) {
-        std::cerr << "Unable to render text surface! Error: " << TTF_GetError() << std::endl;
+void drawEditor(app::AppState &appState, config::EditorConfig &state, GlyphAtlas &atlas, const DrawList &list,
+                size_t first_row, size_t last_row) {
+    if (!atlas.isReady())
         return;
+
+    int cell_w = list.cell_width;
+    int line_h = list.line_height;
+    size_t cursor = list.overlays.cursor;
+    std::optional<size_t> match = list.overlays.match;
+    bool block_cursor = state.ui.cursor_style == config::CursorStyleOpts::CursorBlock;
+
+    auto fillCells = [&](config::Color c, int x, int y, int width) {
+        SDL_SetRenderDrawColor(appState.renderer, c.r, c.g, c.b, c.a);
+        SDL_Rect rect = {x, y, width, line_h};
+        SDL_RenderFillRect(appState.renderer, &rect);
+    };
+
+    SDL_Color color = toSDL(state.font.color);
+    SDL_Color covered = toSDL(state.theme.background);
+    std::string run_text;
+    first_row = std::max(first_row, list.first_row);
+    last_row = std::min(last_row, list.first_row + list.rows.size());
+    for (size_t r = first_row; r < last_row; r++) {
+        const DrawRow &row = list.rows[r - list.first_row];
+        int y = rowY(list, row.row);
+
+        const std::vector<text::PositionedGlyph> &glyphs = row.layout->glyphs;
+        const std::vector<text::LigatureRun> &runs = row.layout->runs;
+        auto run = runs.begin();
+        while (run != runs.end() && run->first < row.from) {
+            run++;
+        }
+        size_t shaped_end = 0;
+        for (size_t i = row.from; i < row.to; i++) {
+            const text::PositionedGlyph &glyph = glyphs[i];
+            size_t at = row.start + glyph.offset;
+            int x = config::positions::x::TEXT + (int)(glyph.column - row.shift) * cell_w;
+            int width = (int)glyph.cells * cell_w;
+            if (match && (at == cursor || at == *match)) {
+                fillCells(state.theme.selection, x, y, width);
+            }
+            if (at == cursor) {
+                fillCells(state.theme.cursor, x, y, block_cursor ? width : 2);
+            }
+            // A ligature run is drawn whole from its first glyph, except under the cursor, where
+            // it falls apart so the character the cursor is on can be told apart. A run a wrap
+            // breaks is drawn glyph by glyph too.
+            if (run != runs.end() && i == run->first) {
+                size_t last = row.start + glyphs[run->first + run->count - 1].offset;
+                if (run->first + run->count <= row.to && (cursor < at || cursor > last)) {
+                    run_text.clear();
+                    for (size_t k = run->first; k < run->first + run->count; k++) {
+                        run_text.push_back((char)glyphs[k].codepoint);
+                    }
+                    if (const Glyph *shaped = atlas.getRun(run_text)) {
+                        atlas.queue(*shaped, (float)x, (float)(y + list.baseline), color);
+                        shaped_end = run->first + run->count;
+                    }
+                }
+                run++;
+            }
+            if (i < shaped_end) {
+                continue;
+            }
+            if (glyph.codepoint != '\t' && glyph.codepoint != ' ') {
+                const Glyph *cached = atlas.get(glyph.codepoint);
+                if (cached)
+                    atlas.queue(*cached, (float)x, (float)(y + list.baseline), at == cursor && block_cursor ? covered : color);
+            }
+        }
+
+        if (cursor == row.end) {
+            fillCells(state.theme.cursor, config::positions::x::TEXT + (int)row.columns * cell_w, y, block_cursor ? cell_w : 2);
+        }
     }
 
-    SDL_Texture *textTexture = SDL_CreateTextureFromSurface(appState.renderer, textSurface);
-    if (textTexture == NULL) {
-        std::cerr << "Unable to create texture! Error: " << SDL_GetError() << std::endl;
-        SDL_FreeSurface(textSurface);
+    // Highlights were filled as each line was walked; the text goes on top in one batch.
+    atlas.flush();
+}
+
+void drawIndentGuides(app::AppState &appState, config::EditorConfig &state, const DrawList &list, size_t first_row,
+                      size_t last_row) {
+    int cell_w = list.cell_width;
+    if (cell_w <= 0 || !state.ui.show_indent_guides)
         return;
+
+    auto guide = state.theme.whitespace;
+    auto active = state.theme.line_number;
+    const std::optional<ScopeGuide> &scope = list.overlays.scope;
+    first_row = std::max(first_row, list.first_row);
+    last_row = std::min(last_row, list.first_row + list.rows.size());
+    for (size_t r = first_row; r < last_row; r++) {
+        const DrawRow &row = list.rows[r - list.first_row];
+        int y = rowY(list, row.row);
+        for (size_t col = 0; col < row.indent; col += list.tab_width) {
+            bool in_scope = scope && col == scope->column && row.row >= scope->top && row.row <= scope->bottom;
+            auto c = in_scope ? active : guide;
+            SDL_SetRenderDrawColor(appState.renderer, c.r, c.g, c.b, c.a);
+            SDL_Rect rect = {config::positions::x::TEXT + (int)col * cell_w, y, 1, list.line_height};
+            SDL_RenderFillRect(appState.renderer, &rect);
+        }
     }
+}
 
-    SDL_Rect renderQuad = {10, 10, textSurface->w, textSurface->h};
-    SDL_RenderCopy(appState.renderer, textTexture, NULL, &renderQuad);
+void drawStatsOverlay(app::AppState &appState, config::EditorConfig &state, GlyphAtlas &atlas,
+                      const std::vector<std::string> &lines) {
+    if (!atlas.isReady() || lines.empty())
+        return;
 
-    SDL_FreeSurface(textSurface);
-    SDL_DestroyTexture(textTexture);
+    int cell_w = atlas.getCellWidth();
+    int line_h = atlas.getLineSkip();
+    size_t columns = 0;
+    for (const std::string &line : lines) {
+        columns = std::max(columns, line.size());
+    }
+    SDL_Rect box = {0, 0, (int)columns * cell_w + 2 * cell_w, (int)lines.size() * line_h + line_h};
+    box.x = appState.window_width - box.w;
+    box.y = appState.window_height - box.h;
+    auto c = state.theme.selection;
+    SDL_SetRenderDrawColor(appState.renderer, c.r, c.g, c.b, c.a);
+    SDL_RenderFillRect(appState.renderer, &box);
+
+    SDL_Color color = toSDL(state.font.color);
+    int baseline = (line_h - atlas.getFontHeight()) / 2;
+    for (size_t r = 0; r < lines.size(); r++) {
+        int y = box.y + line_h / 2 + (int)r * line_h + baseline;
+        for (size_t i = 0; i < lines[r].size(); i++) {
+            if (const Glyph *glyph = atlas.get((unsigned char)lines[r][i])) {
+                atlas.queue(*glyph, (float)(box.x + cell_w + (int)i * cell_w), (float)y, color);
+            }
+        }
+    }
+    atlas.flush();
 }
 }
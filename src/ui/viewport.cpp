@@ -0,0 +1,58 @@
+#include <blip/ui/viewport.hpp>
+#include <algorithm>
+
+namespace ui {
+
+size_t Viewport::getTopLine() const { return top_line; }
+
+int Viewport::getPixelOffset() const { return pixel_offset; }
+
+size_t Viewport::getVisibleRows(int window_height, int line_height) const {
+    if (line_height <= 0 || window_height <= 0) {
+        return 0;
+    }
+    return (size_t)((window_height + pixel_offset + line_height - 1) / line_height);
+}
+
+void Viewport::scrollBy(int pixels, int line_height, size_t line_count) {
+    if (line_height <= 0 || line_count == 0) {
+        return;
+    }
+    long long offset = (long long)pixel_offset + pixels;
+    long long lines = offset / line_height;
+    offset %= line_height;
+    if (offset < 0) {
+        offset += line_height;
+        lines--;
+    }
+    if (lines < 0 && (size_t)-lines > top_line) {
+        top_line = 0;
+        pixel_offset = 0;
+        return;
+    }
+    top_line += lines;
+    pixel_offset = (int)offset;
+    if (top_line >= line_count - 1) {
+        top_line = line_count - 1;
+        pixel_offset = 0;
+    }
+}
+
+void Viewport::setTopLine(size_t row) { top_line = row; }
+
+void Viewport::reveal(size_t row, int window_height, int line_height) {
+    if (line_height <= 0) {
+        return;
+    }
+    if (row < top_line || (row == top_line && pixel_offset > 0)) {
+        top_line = row;
+        pixel_offset = 0;
+        return;
+    }
+    size_t full_rows = (size_t)std::max(1, window_height / line_height);
+    if (row - top_line >= full_rows || (long long)(row - top_line + 1) * line_height - pixel_offset > window_height) {
+        top_line = row + 1 - std::min(full_rows, row + 1);
+        pixel_offset = 0;
+    }
+}
+}